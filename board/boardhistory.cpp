@@ -102,6 +102,28 @@ void BoardHistory::reset(const Board& b)
   turnPieceCount[1][minTurnNumber] = b.pieceCounts[1][0];
 }
 
+void BoardHistory::copyTurnsFrom(const BoardHistory& other, int fromTurn)
+{
+  DEBUGASSERT(fromTurn >= other.minTurnNumber);
+  minTurnNumber = other.minTurnNumber;
+  maxTurnNumber = other.maxTurnNumber;
+  maxTurnBoardNumber = other.maxTurnBoardNumber;
+
+  resizeIfTooSmall();
+  resizeTurnBoardIfTooSmall();
+
+  for(int i = fromTurn; i<=maxTurnNumber; i++)
+  {
+    turnPosHash[i] = other.turnPosHash[i];
+    turnSitHash[i] = other.turnSitHash[i];
+    turnMove[i] = other.turnMove[i];
+    turnPieceCount[0][i] = other.turnPieceCount[0][i];
+    turnPieceCount[1][i] = other.turnPieceCount[1][i];
+  }
+  for(int i = fromTurn; i<=maxTurnBoardNumber; i++)
+    turnBoard[i] = other.turnBoard[i];
+}
+
 //Indicate that move m was made, resulting in board b, and the step number was lastStep prior to m
 //Invalidates all history that occurs in any turns occuring after the turnNumber of b, and appends the results of m to the current
 //turnNumber.
@@ -51,6 +51,11 @@ class BoardHistory
   //board's turnNumber field
   void reset(const Board& b);
 
+  //Make this history match other for all turns from fromTurn onward, leaving earlier turns untouched.
+  //Cost is proportional only to the number of turns copied, so this is cheap when both histories
+  //already share the same start of game.
+  void copyTurnsFrom(const BoardHistory& other, int fromTurn);
+
   //Returns true if the current situation is the third occurrence in the history
   //Always false when steps have been made this turn.
   //Requires that all but potentially the most recent move have been reported for b, possibly without a turnboard.
@@ -0,0 +1,130 @@
+/*
+ * largealloc.cpp
+ * Author: davidwu
+ */
+
+#ifdef _WIN32
+ #define _IS_WINDOWS
+#elif _WIN64
+ #define _IS_WINDOWS
+#elif __linux__
+ #define _IS_LINUX
+#elif __unix
+ #define _IS_UNIX
+#else
+ #error Unknown OS!
+#endif
+
+#ifdef _IS_WINDOWS
+  #include <windows.h>
+#endif
+#if defined(_IS_LINUX) || defined(_IS_UNIX)
+  #include <cstdlib>
+  #include <sys/mman.h>
+#endif
+
+#include "../core/global.h"
+#include "../core/largealloc.h"
+
+using namespace std;
+
+static const size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+static const size_t NORMAL_ALIGNMENT = 4096;
+
+static size_t roundUp(size_t bytes, size_t multiple)
+{
+  return (bytes + multiple - 1) / multiple * multiple;
+}
+
+const char* LargeAlloc::pageTypeName(PageType pageType)
+{
+  switch(pageType)
+  {
+  case PAGES_NORMAL: return "normal pages";
+  case PAGES_TRANSPARENT: return "transparent huge pages";
+  case PAGES_HUGE: return "huge pages";
+  default: return "unknown pages";
+  }
+}
+
+//LINUX AND UNIX IMPLEMENTATION-------------------------------------------------------
+
+#if defined(_IS_LINUX) || defined(_IS_UNIX)
+
+void* LargeAlloc::allocate(size_t bytes, PageType& pageType)
+{
+#ifdef MAP_HUGETLB
+  //Explicit huge pages only work if the administrator has reserved some, so just try it
+  if(bytes >= HUGE_PAGE_SIZE)
+  {
+    void* ptr = mmap(NULL, roundUp(bytes,HUGE_PAGE_SIZE), PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if(ptr != MAP_FAILED)
+    {
+      pageType = PAGES_HUGE;
+      return ptr;
+    }
+  }
+#endif
+
+  size_t alignment = bytes >= HUGE_PAGE_SIZE ? HUGE_PAGE_SIZE : NORMAL_ALIGNMENT;
+  void* ptr = NULL;
+  if(posix_memalign(&ptr, alignment, roundUp(bytes,alignment)) != 0 || ptr == NULL)
+    Global::fatalError("LargeAlloc: could not allocate " + Global::int64ToString((int64_t)bytes) + " bytes");
+
+  pageType = PAGES_NORMAL;
+#ifdef MADV_HUGEPAGE
+  if(alignment == HUGE_PAGE_SIZE && madvise(ptr, roundUp(bytes,alignment), MADV_HUGEPAGE) == 0)
+    pageType = PAGES_TRANSPARENT;
+#endif
+  return ptr;
+}
+
+void LargeAlloc::free(void* ptr, size_t bytes, PageType pageType)
+{
+  if(ptr == NULL)
+    return;
+  if(pageType == PAGES_HUGE)
+    munmap(ptr, roundUp(bytes,HUGE_PAGE_SIZE));
+  else
+    std::free(ptr);
+}
+
+#endif
+
+//WINDOWS IMPLEMENTATION--------------------------------------------------------------
+
+#ifdef _IS_WINDOWS
+
+void* LargeAlloc::allocate(size_t bytes, PageType& pageType)
+{
+  //Large pages require the "Lock pages in memory" privilege, so this usually fails unless configured
+  size_t largePageSize = GetLargePageMinimum();
+  if(largePageSize > 0 && bytes >= largePageSize)
+  {
+    void* ptr = VirtualAlloc(NULL, roundUp(bytes,largePageSize),
+        MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if(ptr != NULL)
+    {
+      pageType = PAGES_HUGE;
+      return ptr;
+    }
+  }
+
+  void* ptr = VirtualAlloc(NULL, roundUp(bytes,NORMAL_ALIGNMENT), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if(ptr == NULL)
+    Global::fatalError("LargeAlloc: could not allocate " + Global::int64ToString((int64_t)bytes) + " bytes");
+  pageType = PAGES_NORMAL;
+  return ptr;
+}
+
+void LargeAlloc::free(void* ptr, size_t bytes, PageType pageType)
+{
+  (void)bytes;
+  (void)pageType;
+  if(ptr == NULL)
+    return;
+  VirtualFree(ptr, 0, MEM_RELEASE);
+}
+
+#endif
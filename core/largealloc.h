@@ -0,0 +1,34 @@
+/*
+ * largealloc.h
+ * Author: davidwu
+ *
+ * Allocation of large, page-aligned blocks of memory, such as for hashtables.
+ * Tries to back the memory with huge pages to cut down on TLB misses, falling back
+ * to normal pages if the OS or its configuration doesn't allow it.
+ */
+
+#ifndef LARGEALLOC_H_
+#define LARGEALLOC_H_
+
+#include <cstddef>
+
+namespace LargeAlloc
+{
+  enum PageType
+  {
+    PAGES_NORMAL = 0,       //Ordinary pages
+    PAGES_TRANSPARENT = 1,  //Ordinary allocation, but advised to the OS to use transparent huge pages
+    PAGES_HUGE = 2,         //Explicitly reserved huge or large pages
+  };
+
+  //Allocate at least the given number of bytes, aligned to at least a page.
+  //The contents are NOT guaranteed to be zeroed. Fails fatally if no memory could be obtained.
+  void* allocate(size_t bytes, PageType& pageType);
+
+  //Free memory obtained from allocate, passing the same size and the page type that was returned
+  void free(void* ptr, size_t bytes, PageType pageType);
+
+  const char* pageTypeName(PageType pageType);
+}
+
+#endif /* LARGEALLOC_H_ */
@@ -0,0 +1,223 @@
+/*
+ * numa.cpp
+ * Author: davidwu
+ */
+
+#ifdef _WIN32
+ #define _IS_WINDOWS
+#elif _WIN64
+ #define _IS_WINDOWS
+#elif __linux__
+ #define _IS_LINUX
+#elif __unix
+ #define _IS_UNIX
+#else
+ #error Unknown OS!
+#endif
+
+#ifdef _IS_LINUX
+  #include <cstdio>
+  #include <cstdlib>
+  #include <cstring>
+  #include <vector>
+  #include <algorithm>
+  #include <dirent.h>
+  #include <sched.h>
+  #include <unistd.h>
+  #include <sys/syscall.h>
+#endif
+
+#include "../core/global.h"
+#include "../core/numa.h"
+
+using namespace std;
+
+//LINUX IMPLEMENTATION----------------------------------------------------------------
+
+#ifdef _IS_LINUX
+
+//Mode for mbind, from linux/mempolicy.h, which we avoid depending on along with libnuma
+static const int MPOL_INTERLEAVE_MODE = 3;
+
+//Ids of all nodes that the kernel reports, which need not be contiguous
+static vector<int> getNodeIds()
+{
+  vector<int> ids;
+  DIR* dir = opendir("/sys/devices/system/node");
+  if(dir == NULL)
+    return ids;
+  struct dirent* entry;
+  while((entry = readdir(dir)) != NULL)
+  {
+    const char* name = entry->d_name;
+    if(strncmp(name,"node",4) == 0 && name[4] >= '0' && name[4] <= '9')
+      ids.push_back(atoi(name+4));
+  }
+  closedir(dir);
+  return ids;
+}
+
+//Cpus in a node's cpulist file, in a format like "0-3,8-11"
+static vector<int> getNodeCpus(int nodeId)
+{
+  vector<int> cpus;
+  char path[64];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodeId);
+  FILE* file = fopen(path,"r");
+  if(file == NULL)
+    return cpus;
+  int lo;
+  while(fscanf(file,"%d",&lo) == 1)
+  {
+    int hi = lo;
+    int c = fgetc(file);
+    if(c == '-')
+    {
+      if(fscanf(file,"%d",&hi) != 1)
+        break;
+      c = fgetc(file);
+    }
+    for(int cpu = lo; cpu <= hi; cpu++)
+      cpus.push_back(cpu);
+    if(c != ',')
+      break;
+  }
+  fclose(file);
+  return cpus;
+}
+
+//The cpus the process may run on, taking round-robin one from each node in turn so that pinning consecutive
+//threads spreads them across nodes. Cpus that no node claims are grouped as one more node.
+static vector<int> computePinOrder()
+{
+  vector<int> order;
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if(sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return order;
+
+  vector<int> ids = getNodeIds();
+  sort(ids.begin(),ids.end());
+  vector<vector<int> > groups;
+  vector<bool> claimed(CPU_SETSIZE,false);
+  for(size_t i = 0; i<ids.size(); i++)
+  {
+    vector<int> nodeCpus = getNodeCpus(ids[i]);
+    vector<int> group;
+    for(size_t j = 0; j<nodeCpus.size(); j++)
+    {
+      int cpu = nodeCpus[j];
+      if(cpu >= 0 && cpu < CPU_SETSIZE && !claimed[cpu] && CPU_ISSET(cpu,&allowed))
+      {
+        claimed[cpu] = true;
+        group.push_back(cpu);
+      }
+    }
+    if(group.size() > 0)
+      groups.push_back(group);
+  }
+  vector<int> unclaimed;
+  for(int cpu = 0; cpu<CPU_SETSIZE; cpu++)
+    if(!claimed[cpu] && CPU_ISSET(cpu,&allowed))
+      unclaimed.push_back(cpu);
+  if(unclaimed.size() > 0)
+    groups.push_back(unclaimed);
+
+  for(size_t round = 0; order.size() < (size_t)CPU_COUNT(&allowed); round++)
+    for(size_t i = 0; i<groups.size(); i++)
+      if(round < groups[i].size())
+        order.push_back(groups[i][round]);
+  return order;
+}
+
+//Computed during static initialization, before any thread could have been pinned
+static const vector<int> pinOrder = computePinOrder();
+
+bool Numa::pinCurrentThread(int idx)
+{
+  if(pinOrder.size() <= 0 || idx < 0)
+    return false;
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(pinOrder[idx % pinOrder.size()], &cpus);
+  return sched_setaffinity(0, sizeof(cpus), &cpus) == 0;
+}
+
+vector<int> Numa::getCurrentAffinity()
+{
+  vector<int> cpus;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  if(sched_getaffinity(0, sizeof(set), &set) != 0)
+    return cpus;
+  for(int cpu = 0; cpu<CPU_SETSIZE; cpu++)
+    if(CPU_ISSET(cpu,&set))
+      cpus.push_back(cpu);
+  return cpus;
+}
+
+bool Numa::setCurrentAffinity(const vector<int>& cpus)
+{
+  if(cpus.size() <= 0)
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for(size_t i = 0; i<cpus.size(); i++)
+    if(cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+      CPU_SET(cpus[i], &set);
+  return sched_setaffinity(0, sizeof(set), &set) == 0;
+}
+
+void Numa::interleave(void* ptr, size_t bytes)
+{
+#ifdef SYS_mbind
+  vector<int> ids = getNodeIds();
+  if(ids.size() <= 1 || ptr == NULL || bytes == 0)
+    return;
+
+  int maxId = 0;
+  for(size_t i = 0; i<ids.size(); i++)
+    maxId = ids[i] > maxId ? ids[i] : maxId;
+  const int bitsPerWord = sizeof(unsigned long) * 8;
+  vector<unsigned long> mask(maxId / bitsPerWord + 1, 0);
+  for(size_t i = 0; i<ids.size(); i++)
+    mask[ids[i] / bitsPerWord] |= 1UL << (ids[i] % bitsPerWord);
+
+  //Purely advisory, so if the kernel refuses we just keep the default placement
+  syscall(SYS_mbind, ptr, bytes, MPOL_INTERLEAVE_MODE, mask.data(), mask.size() * bitsPerWord + 1, 0);
+#else
+  (void)ptr;
+  (void)bytes;
+#endif
+}
+
+#endif
+
+//OTHER PLATFORMS---------------------------------------------------------------------
+
+#ifndef _IS_LINUX
+
+bool Numa::pinCurrentThread(int idx)
+{
+  (void)idx;
+  return false;
+}
+
+vector<int> Numa::getCurrentAffinity()
+{
+  return vector<int>();
+}
+
+bool Numa::setCurrentAffinity(const vector<int>& cpus)
+{
+  (void)cpus;
+  return false;
+}
+
+void Numa::interleave(void* ptr, size_t bytes)
+{
+  (void)ptr;
+  (void)bytes;
+}
+
+#endif
@@ -0,0 +1,33 @@
+/*
+ * numa.h
+ * Author: davidwu
+ *
+ * Placement of threads and memory on machines with multiple NUMA nodes (sockets).
+ * Everything here quietly does nothing on single-node machines or on platforms where it isn't implemented.
+ */
+
+#ifndef NUMA_H_
+#define NUMA_H_
+
+#include <cstddef>
+#include <vector>
+
+namespace Numa
+{
+  //Pin the calling thread to a single logical cpu out of those the process was allowed to run on at startup.
+  //Consecutive idxs go round-robin across the nodes, wrapping around if there are more idxs than cpus.
+  //Returns false if unsupported or if the OS refused.
+  bool pinCurrentThread(int idx);
+
+  //The cpus the calling thread may currently run on, so that they can be restored after pinning it.
+  //Empty if unsupported.
+  std::vector<int> getCurrentAffinity();
+  //Let the calling thread run on exactly the given cpus. Does nothing and returns false if cpus is empty.
+  bool setCurrentAffinity(const std::vector<int>& cpus);
+
+  //Ask the OS to spread the pages of this page-aligned memory evenly across all nodes, rather than placing
+  //them all on the node of whatever thread touches them first. Must be called before the memory is touched.
+  void interleave(void* ptr, size_t bytes);
+}
+
+#endif /* NUMA_H_ */
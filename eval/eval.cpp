@@ -6,9 +6,11 @@
 
 #include <cstdio>
 #include <cmath>
+#include <thread>
 #include "../core/global.h"
 #include "../board/bitmap.h"
 #include "../board/board.h"
+#include "../board/boardtrees.h"
 #include "../eval/internal.h"
 #include "../eval/threats.h"
 #include "../eval/strats.h"
@@ -21,6 +23,43 @@ using namespace std;
 
 eval_t Eval::evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, ostream* outstream)
 {
+  bool isLazy;
+  return evaluate(b,mainPla,earlyBlockadePenalty,LOSE-1,WIN+1,NULL,isLazy,outstream);
+}
+
+static void evaluateRange(Board* boards, int start, int end, pla_t mainPla, eval_t earlyBlockadePenalty,
+    eval_t* evals)
+{
+  for(int i = start; i<end; i++)
+    evals[i] = Eval::evaluate(boards[i],mainPla,earlyBlockadePenalty,NULL);
+}
+
+void Eval::evaluateBatch(Board* boards, int numBoards, pla_t mainPla, eval_t earlyBlockadePenalty,
+    eval_t* evals, int numThreads)
+{
+  if(numThreads > numBoards)
+    numThreads = numBoards;
+  if(numThreads <= 1)
+  {
+    evaluateRange(boards,0,numBoards,mainPla,earlyBlockadePenalty,evals);
+    return;
+  }
+
+  vector<std::thread> threads;
+  for(int i = 0; i<numThreads; i++)
+  {
+    int start = (int)((int64_t)numBoards * i / numThreads);
+    int end = (int)((int64_t)numBoards * (i+1) / numThreads);
+    threads.push_back(std::thread(&evaluateRange,boards,start,end,mainPla,earlyBlockadePenalty,evals));
+  }
+  for(int i = 0; i<numThreads; i++)
+    threads[i].join();
+}
+
+eval_t Eval::evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, eval_t alpha, eval_t beta,
+    const LazyMargins* lazy, bool& isLazy, ostream* outstream)
+{
+  isLazy = false;
   pla_t pla = b.player;
   pla_t opp = gOpp(pla);
   eval_t totalScore = 0;
@@ -54,6 +93,24 @@ eval_t Eval::evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, ostr
   totalScore += tDefScore;
   totalScore += tcScore;
 
+  //Lazy exit--------------------------------------------------------------------------
+  if(lazy != NULL && outstream == NULL)
+  {
+    eval_t lazyScore = totalScore + SearchParams::STEPS_LEFT_BONUS[4-b.step];
+    eval_t lazyLow = lazyScore - lazy->downTotal;
+    if(lazyLow >= beta)
+    {isLazy = true; return lazyLow;}
+    eval_t lazyHigh = lazyScore + lazy->upTotal;
+    if(lazyHigh <= alpha)
+    {
+      //Captures only count if pla can capture anything at all, so only check for that if it would matter
+      if(lazyHigh + lazy->up[LAZY_CAPTURES] <= alpha)
+      {isLazy = true; return lazyHigh + lazy->up[LAZY_CAPTURES];}
+      if(!BoardTrees::canCaps(b,pla,4-b.step))
+      {isLazy = true; return lazyHigh;}
+    }
+  }
+
   //Elephant Mobility------------------------------------------------------------------
   const int eleCanReachMax = EMOB_MAX;
   Bitmap eleCanReach[2][EMOB_ARR_LEN];
@@ -204,6 +261,37 @@ eval_t Eval::evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, ostr
   return finalScore;
 }
 
+//Mobility, threats (including reductions), strats, placement, goal threats, captures, variance
+static const eval_t DEFAULT_LAZY_UP[Eval::NUM_LAZY_TERMS] =   {160,1100,0,330,120,2000,10};
+static const eval_t DEFAULT_LAZY_DOWN[Eval::NUM_LAZY_TERMS] = {130, 830,0,190,150,   0,20};
+
+Eval::LazyMargins::LazyMargins()
+{
+  setScaled(100);
+}
+
+void Eval::LazyMargins::setScaled(int percent)
+{
+  for(int i = 0; i<NUM_LAZY_TERMS; i++)
+  {
+    up[i] = DEFAULT_LAZY_UP[i] * percent / 100;
+    down[i] = DEFAULT_LAZY_DOWN[i] * percent / 100;
+  }
+  updateTotals();
+}
+
+void Eval::LazyMargins::updateTotals()
+{
+  upTotal = 0;
+  downTotal = 0;
+  for(int i = 0; i<NUM_LAZY_TERMS; i++)
+  {
+    if(i != LAZY_CAPTURES)
+      upTotal += up[i];
+    downTotal += down[i];
+  }
+}
+
 //We model our winning probability as a logistic 1/(1+exp(-X/K)) where X is the eval score and where this value is K.
 //Some points that we would normally score we count as "variance points", and omit from the eval score until the end.
 //At the end, we compute our winning probability P given our score so far. We assume that due to local variance we
@@ -38,6 +38,44 @@ namespace Eval
   //If out is not NULL, then will use out to print out some debugging info
   eval_t evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, ostream* out);
 
+  //LAZY EVALUATION-------------------------------------------------------------
+  //Groups of terms that a lazy eval skips, each with its own margin
+  enum LazyTerm
+  {
+    LAZY_MOBILITY, LAZY_THREATS, LAZY_STRATS, LAZY_PLACEMENT, LAZY_RABGOAL, LAZY_CAPTURES, LAZY_VARIANCE,
+    NUM_LAZY_TERMS
+  };
+
+  //How far each group of skipped terms is assumed to move the score, from the player to move's perspective.
+  //The defaults are around the 99.9th percentiles in middlegame searches. Captures only ever add, and only
+  //count when the player to move can capture something at all.
+  struct LazyMargins
+  {
+    eval_t up[NUM_LAZY_TERMS];
+    eval_t down[NUM_LAZY_TERMS];
+    eval_t upTotal;   //Sum of up, except for captures
+    eval_t downTotal; //Sum of down
+
+    LazyMargins();
+    //Set to the defaults times percent/100
+    void setScaled(int percent);
+    //Recompute the totals after changing up or down
+    void updateTotals();
+  };
+
+  //Same, but if lazy is not NULL, stops after material, piece-square and trap control if the score so far is already
+  //outside of (alpha,beta) by more than the margins could move it, skipping mobility, threats, strats, placement,
+  //goal threats and captures. Then sets isLazy and returns the score moved by the margins towards the window, which
+  //is a bound (<= alpha or >= beta) so long as each group is within its margin. Never lazy if out is not NULL.
+  eval_t evaluate(Board& b, pla_t mainPla, eval_t earlyBlockadePenalty, eval_t alpha, eval_t beta,
+      const LazyMargins* lazy, bool& isLazy, ostream* out);
+
+  //Evaluate each of numBoards boards with the same mainPla and earlyBlockadePenalty, storing the scores in evals.
+  //The boards are split into contiguous chunks among numThreads threads and evaluated in place, so they must not
+  //be in use elsewhere. The eval parameters must not change until this returns.
+  void evaluateBatch(Board* boards, int numBoards, pla_t mainPla, eval_t earlyBlockadePenalty,
+      eval_t* evals, int numThreads);
+
   //INITIALIZATION-------------------------------------------------------------------
 
   //Initialize eval tables. Call this before using Eval!
@@ -6,6 +6,7 @@
 
 #include <algorithm>
 #include "../core/global.h"
+#include "../core/boostthread.h"
 #include "../board/bitmap.h"
 #include "../board/board.h"
 #include "../eval/threats.h"
@@ -81,6 +82,65 @@ static void addFeatureToVector(findex_t x, void* v)
   vec->push_back(x);
 }
 
+static void getFeatureSumsRange(const ArimaaFeatureSet* afset, const Board* b, const void* data, pla_t pla,
+    const move_t* moves, int start, int end, const BoardHistory* hist, const vector<double>* featureWeights, double* sumsBuf)
+{
+  //Extract the features for all the moves into one buffer, where those of move i are at [moveStarts[i],moveStarts[i+1])
+  int num = end-start;
+  vector<findex_t> features;
+  vector<int> moveStarts(num+1);
+  features.reserve(num * 32);
+
+  Board copy = *b;
+  UndoMoveData uData;
+  for(int i = 0; i<num; i++)
+  {
+    moveStarts[i] = features.size();
+    copy.makeMove(moves[start+i],uData);
+    afset->getFeaturesFunc(copy,data,pla,moves[start+i],*hist,&addFeatureToVector,&features);
+    copy.undoMove(uData);
+  }
+  moveStarts[num] = features.size();
+
+  //Then sum them, in the same order as getFeatureSum so that the results are identical
+  const double* weights = featureWeights->data();
+  const findex_t* f = features.data();
+  for(int i = 0; i<num; i++)
+  {
+    double accum = 0;
+    for(int j = moveStarts[i]; j<moveStarts[i+1]; j++)
+      accum += weights[f[j]];
+    sumsBuf[start+i] = accum;
+  }
+}
+
+void ArimaaFeatureSet::getFeatureSums(const Board& b, const void* data, pla_t pla, const move_t* moves, int numMoves,
+    const BoardHistory& hist, const vector<double>& featureWeights, double* sumsBuf, int numThreads) const
+{
+  DEBUGASSERT((int)featureWeights.size() == fset->numFeatures);
+
+  //Don't bother with threads unless each one gets a decent chunk to do
+  static const int MIN_MOVES_PER_THREAD = 256;
+  if(numThreads > 1 && numMoves / MIN_MOVES_PER_THREAD < numThreads)
+    numThreads = max(1, numMoves / MIN_MOVES_PER_THREAD);
+
+  if(numThreads <= 1)
+    getFeatureSumsRange(this,&b,data,pla,moves,0,numMoves,&hist,&featureWeights,sumsBuf);
+  else
+  {
+    vector<std::thread> threads;
+    int chunk = numMoves / numThreads;
+    for(int i = 0; i<numThreads; i++)
+    {
+      int start = chunk * i;
+      int end = i == numThreads-1 ? numMoves : chunk * (i+1);
+      threads.push_back(std::thread(&getFeatureSumsRange,this,&b,data,pla,moves,start,end,&hist,&featureWeights,sumsBuf));
+    }
+    for(int i = 0; i<numThreads; i++)
+      threads[i].join();
+  }
+}
+
 vector<findex_t> ArimaaFeatureSet::getFeatures(Board& bAfter, const void* data,
     pla_t pla, move_t move, const BoardHistory& hist) const
 {
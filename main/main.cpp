@@ -133,6 +133,8 @@ static int callMain(int argc, const char* const *argv)
 
     MainFuncEntry("ponderHitRate", MainFuncs::ponderHitRate),
     MainFuncEntry("checkSpeed", MainFuncs::checkSpeed),
+    MainFuncEntry("bench", MainFuncs::bench),
+    MainFuncEntry("microBench", MainFuncs::microBench),
     MainFuncEntry("testTactics", MainFuncs::testTactics),
 
     MainFuncEntry("boardProperties", MainFuncs::boardProperties),
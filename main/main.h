@@ -118,6 +118,8 @@ namespace MainFuncs
 
   int ponderHitRate(int argc, const char* const *argv);
   int checkSpeed(int argc, const char* const *argv);
+  int bench(int argc, const char* const *argv);
+  int microBench(int argc, const char* const *argv);
   int testTactics(int argc, const char* const *argv);
 
   int boardProperties(int argc, const char* const *argv);
@@ -94,6 +94,7 @@ struct Event
     int bestMoveSearchId;
   };
   string* bestMoveLogMessage;
+  vector<string>* bestMoveMultiPV;
 
   void free()
   {
@@ -113,6 +114,7 @@ struct Event
     else if(type == BESTMOVE)
     {
       delete bestMoveLogMessage;
+      delete bestMoveMultiPV;
     }
   }
 
@@ -334,6 +336,7 @@ static void handleSearchDone(move_t move, int searchId, const SearchStats& stats
   << " Time " << stats.timeTaken
   << " Seed " << Global::uint64ToHexString(stats.randSeed);
   event.bestMoveLogMessage = new string(bestMoveLogMessage.str());
+  event.bestMoveMultiPV = new vector<string>(stats.multiPVStrings);
   eventQueue->push(event);
 }
 
@@ -499,14 +502,64 @@ int MainFuncs::aei(int argc, const char* const *argv)
         params.fullMoveHashExp = max(14,min(exp-1,defaultExp));
         logMessage("Hashtable size set to 2^" + Global::intToString(exp) + ", effective next search");
       }
+      else if(*(event.inputSetOptionKey) == "savehash" || *(event.inputSetOptionKey) == "loadhash")
+      {
+        if(asyncBot == NULL)
+        {
+          logError(*(event.inputSetOptionKey) + " called before newgame");
+          break;
+        }
+        searchId++; //Invalidate any earlier search's move
+        string file = *(event.inputSetOptionValue);
+        if(*(event.inputSetOptionKey) == "savehash")
+        {
+          asyncBot->saveHash(file);
+          logMessage("Hashtable saved to " + file);
+        }
+        else
+        {
+          int exp = asyncBot->loadHash(file);
+          params.mainHashExp = exp;
+          logMessage("Hashtable of size 2^" + Global::intToString(exp) + " loaded from " + file);
+        }
+      }
       else if(*(event.inputSetOptionKey) == "threads" && Global::tryStringToInt(*(event.inputSetOptionValue),i))
       {
         int threads = i;
         if(threads <= 0) threads = 1;
-        if(threads > SearchParams::MAX_THREADS) threads = SearchParams::MAX_THREADS;
         params.setNumThreads(threads);
         logMessage("Threads set to " + Global::intToString(threads));
       }
+      else if(*(event.inputSetOptionKey) == "multipv" && Global::tryStringToInt(*(event.inputSetOptionValue),i))
+      {
+        int num = i;
+        if(num <= 0) num = 1;
+        params.setMultiPV(num);
+        logMessage("Multipv set to " + Global::intToString(num));
+      }
+      else if(*(event.inputSetOptionKey) == "pinthreads" && Global::tryStringToBool(*(event.inputSetOptionValue),bit))
+      {
+        params.setPinThreads(bit);
+        if(bit)
+          logMessage("Pin threads set to true");
+        else
+          logMessage("Pin threads set to false");
+      }
+      else if(*(event.inputSetOptionKey) == "streamroot" && Global::tryStringToBool(*(event.inputSetOptionValue),bit))
+      {
+        params.setStreamRootMoves(bit);
+        if(bit)
+          logMessage("Stream root set to true");
+        else
+          logMessage("Stream root set to false");
+      }
+      else if(*(event.inputSetOptionKey) == "lazyeval" && Global::tryStringToInt(*(event.inputSetOptionValue),i))
+      {
+        int percent = i;
+        if(percent < 0) percent = 0;
+        params.setLazyEval(percent,false);
+        logMessage("Lazy eval margin percent set to " + Global::intToString(percent));
+      }
       else if(*(event.inputSetOptionKey) == "ignoretc" && Global::tryStringToBool(*(event.inputSetOptionValue),bit))
       {
         ignoreTC = bit;
@@ -721,6 +774,8 @@ int MainFuncs::aei(int argc, const char* const *argv)
         else
         {
           logMessage(*event.bestMoveLogMessage);
+          for(int i = 0; i<(int)event.bestMoveMultiPV->size(); i++)
+            reply("info multipv " + Global::intToString(i+1) + " " + (*event.bestMoveMultiPV)[i]);
           reply("bestmove " + Board::writeMove(b,move,false));
         }
       }
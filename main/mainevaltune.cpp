@@ -145,19 +145,27 @@ static double pseudoWinProbability(eval_t eval, double winProbScale)
   return 1.0 / (1.0 + exp(-eval/winProbScale));
 }
 
-static eval_t getEvaluation(Searcher& searcher, int realDepth, const Board& board, const BoardHistory& hist)
+//Returns true and sets eval if the game is over or the result is clear without evaluating
+static bool getTerminalEvaluation(Board& b, eval_t& eval)
 {
-  Board b = board;
-
-  pla_t winner = board.getWinner();
+  pla_t winner = b.getWinner();
   if(winner != NPLA)
-    return winner == b.player ? Eval::WIN : Eval::LOSE;
+  {eval = winner == b.player ? Eval::WIN : Eval::LOSE; return true;}
   if(BoardTrees::goalDist(b,b.player,4-b.step) < 5)
-    return Eval::WIN;
+  {eval = Eval::WIN; return true;}
   else if(SearchMoveGen::definitelyForcedLossInTwo(b))
-    return Eval::LOSE;
+  {eval = Eval::LOSE; return true;}
+  return false;
+}
+
+static eval_t getEvaluation(Searcher& searcher, int realDepth, const Board& board, const BoardHistory& hist)
+{
+  Board b = board;
 
   eval_t eval;
+  if(getTerminalEvaluation(b,eval))
+    return eval;
+
   if(realDepth <= -2)
     eval = Eval::evaluate(b,NPLA,0,NULL);
   else
@@ -168,6 +176,37 @@ static eval_t getEvaluation(Searcher& searcher, int realDepth, const Board& boar
   return eval;
 }
 
+//Static evals for the tuning passes are gathered and done in chunks of this many boards, each chunk consumed before
+//the next is gathered, so that memory stays bounded no matter how many positions there are
+static const int STATIC_EVAL_CHUNK = 4096;
+
+//Same as getEvaluation for each board with realDepth <= -2, but with the static evals done in one batch
+//split among numThreads threads. Reorders boards.
+static void getStaticEvaluations(vector<Board>& boards, int numThreads, vector<eval_t>& evals)
+{
+  int numBoards = boards.size();
+  evals.resize(numBoards);
+  vector<int> toEvalIdxs;
+  int numToEval = 0;
+  for(int i = 0; i<numBoards; i++)
+  {
+    if(!getTerminalEvaluation(boards[i],evals[i]))
+    {
+      //Move the boards to evaluate to the front, so they can be batched without copying them elsewhere
+      if(numToEval != i)
+        boards[numToEval] = boards[i];
+      toEvalIdxs.push_back(i);
+      numToEval++;
+    }
+  }
+
+  vector<eval_t> staticEvals(numToEval);
+  if(numToEval > 0)
+    Eval::evaluateBatch(boards.data(),numToEval,NPLA,0,staticEvals.data(),numThreads);
+  for(int i = 0; i<numToEval; i++)
+    evals[toEvalIdxs[i]] = staticEvals[i];
+}
+
 int MainFuncs::modelEvalLikelihood(int argc, const char* const *argv)
 {
   //The model used is that the winning probability in a position is 1/(1+exp(eval/winprobscale))
@@ -340,63 +379,164 @@ static double averageDefault1(const vector<double>& vec)
   return sum / (double)size;
 }
 
-static double getTDLambdaVariance(GameIterator& iter, Searcher& searcher, int depth, double winProbScale, double horizon)
+namespace {
+//What the td-lambda pass needs to know about a position besides its eval, so that evals can be done ahead in chunks
+struct TDLambdaPos
 {
-  setGoodEvalFiltering(iter);
-  iter.reset();
-  double variance = 0;
+  int gameIdx;
+  pla_t pla;
+  bool filter;
+  double posWeight;
+  pla_t winner; //Winner right after the game move from this position, if any
+};
+
+//Accumulates the td-lambda variance over the positions of the games in order
+struct TDLambdaAccum
+{
+  double horizon;
+  double winProbScale;
+  double variance;
   vector<eval_t> evals;
   vector<bool> filter;
   vector<double> posWeights;
-  int prevGameIdx = -1;
-  while(iter.next())
+  int prevGameIdx;
+
+  TDLambdaAccum(double h, double scale)
+  :horizon(h),winProbScale(scale),variance(0),prevGameIdx(-1)
+  {}
+
+  void endGame()
   {
-    if(iter.getGameIdx() != prevGameIdx)
+    variance += tdLambdaVariance(evals,filter,horizon,winProbScale) * averageDefault1(posWeights);
+    evals.clear();
+    filter.clear();
+    posWeights.clear();
+  }
+
+  void add(const TDLambdaPos& pos, eval_t eval)
+  {
+    if(pos.gameIdx != prevGameIdx)
+    {
+      endGame();
+      prevGameIdx = pos.gameIdx;
+    }
+
+    evals.push_back(pos.pla == GOLD ? eval : -eval);
+    filter.push_back(pos.filter);
+    posWeights.push_back(pos.posWeight);
+
+    if(pos.winner != NPLA)
     {
-      variance += tdLambdaVariance(evals,filter,horizon,winProbScale) * averageDefault1(posWeights);
-      evals.clear();
-      filter.clear();
-      posWeights.clear();
-      prevGameIdx = iter.getGameIdx();
+      if(pos.winner == GOLD) evals.push_back(Eval::WIN);
+      else if(pos.winner == SILV) evals.push_back(Eval::LOSE);
+      endGame();
     }
+  }
+};
+}
 
+//Evaluate a chunk of gathered positions and add them to accum
+static void flushTDLambdaChunk(vector<Board>& boards, vector<TDLambdaPos>& positions, int numThreads, TDLambdaAccum& accum)
+{
+  vector<eval_t> evals;
+  getStaticEvaluations(boards,numThreads,evals);
+  int numPositions = positions.size();
+  for(int i = 0; i<numPositions; i++)
+    accum.add(positions[i],evals[i]);
+  boards.clear();
+  positions.clear();
+}
+
+static double getTDLambdaVariance(GameIterator& iter, Searcher& searcher, int depth, double winProbScale, double horizon)
+{
+  setGoodEvalFiltering(iter);
+
+  //If only static evals are needed, gather the positions and evaluate them in batches
+  bool batched = depth <= -2;
+  vector<Board> chunkBoards;
+  vector<TDLambdaPos> chunkPositions;
+  TDLambdaAccum accum(horizon,winProbScale);
+
+  iter.reset();
+  while(iter.next())
+  {
     Board b = iter.getBoard();
     const BoardHistory& hist = iter.getHist();
 
-    eval_t eval = getEvaluation(searcher,depth,b,hist);
-    evals.push_back(b.player == GOLD ? eval : -eval);
-    filter.push_back(iter.wouldFilterCurrent());
-    posWeights.push_back(iter.getPosWeight());
+    TDLambdaPos pos;
+    pos.gameIdx = iter.getGameIdx();
+    pos.pla = b.player;
+    pos.filter = iter.wouldFilterCurrent();
+    pos.posWeight = iter.getPosWeight();
+
+    eval_t eval = 0;
+    if(batched)
+      chunkBoards.push_back(b);
+    else
+      eval = getEvaluation(searcher,depth,b,hist);
 
     bool suc = b.makeMoveLegalNoUndo(iter.getNextMove());
     DEBUGASSERT(suc);
+    pos.winner = b.getWinner();
 
-    pla_t winner = b.getWinner();
-    if(winner != NPLA)
+    if(!batched)
+      accum.add(pos,eval);
+    else
     {
-      if(winner == GOLD) evals.push_back(Eval::WIN);
-      else if(winner == SILV) evals.push_back(Eval::LOSE);
-      variance += tdLambdaVariance(evals,filter,horizon,winProbScale) * averageDefault1(posWeights);
-      evals.clear();
-      filter.clear();
-      posWeights.clear();
+      chunkPositions.push_back(pos);
+      if((int)chunkBoards.size() >= STATIC_EVAL_CHUNK)
+        flushTDLambdaChunk(chunkBoards,chunkPositions,searcher.params.numThreads,accum);
     }
   }
+  if(batched)
+    flushTDLambdaChunk(chunkBoards,chunkPositions,searcher.params.numThreads,accum);
+
+  accum.endGame();
+  return accum.variance;
+}
+
+//Add the variance for a move whose eval went from baseEval to nextEval for the player making it
+static void addMovesArePositive(eval_t baseEval, eval_t nextEval, double posWeight, double winProbScale, double& variance)
+{
+  if(nextEval < baseEval)
+  {
+    double diff = pseudoWinProbability(baseEval,winProbScale) - pseudoWinProbability(nextEval,winProbScale);
+    variance += diff * diff * posWeight;
+  }
+}
 
-  variance += tdLambdaVariance(evals,filter,horizon,winProbScale) * averageDefault1(posWeights);
-  evals.clear();
-  filter.clear();
+//Evaluate a chunk of gathered positions, the position before each move followed by the one after it unless the
+//move won, and add them to variance
+static void flushMovesArePositiveChunk(vector<Board>& boards, vector<double>& posWeights, vector<bool>& hasNexts,
+    int numThreads, double winProbScale, double& variance)
+{
+  vector<eval_t> evals;
+  getStaticEvaluations(boards,numThreads,evals);
+  int numPositions = posWeights.size();
+  int evalIdx = 0;
+  for(int i = 0; i<numPositions; i++)
+  {
+    eval_t baseEval = evals[evalIdx++];
+    if(hasNexts[i])
+      addMovesArePositive(baseEval,evals[evalIdx++],posWeights[i],winProbScale,variance);
+  }
+  boards.clear();
   posWeights.clear();
-  return variance;
+  hasNexts.clear();
 }
 
 static double getMovesArePositiveVariance(GameIterator& iter, Searcher& searcher, int depth, double winProbScale)
 {
   setGoodMoveFiltering(iter);
+
+  //If only static evals are needed, gather the positions and evaluate them in batches
+  bool batched = depth <= -2;
+  vector<Board> chunkBoards;
+  vector<double> chunkPosWeights;
+  vector<bool> chunkHasNexts;
+
   iter.reset();
   double variance = 0;
-  vector<eval_t> evals;
-  vector<bool> filter;
   while(iter.next())
   {
     if(iter.wouldFilterCurrent())
@@ -408,24 +548,40 @@ static double getMovesArePositiveVariance(GameIterator& iter, Searcher& searcher
     Board b = iter.getBoard();
     const BoardHistory& hist = iter.getHist();
 
-    eval_t baseEval = getEvaluation(searcher,depth,b,hist);
+    eval_t baseEval = 0;
+    if(batched)
+      chunkBoards.push_back(b);
+    else
+      baseEval = getEvaluation(searcher,depth,b,hist);
+
     bool suc = b.makeMoveLegalNoUndo(iter.getNextMove());
     DEBUGASSERT(suc);
-    pla_t winner = b.getWinner();
-    if(winner != NPLA)
-      continue;
-
-    b.setPlaStep(gOpp(b.player),0);
-    b.refreshStartHash();
-    BoardHistory newHist = BoardHistory(b);
-    eval_t nextEval = getEvaluation(searcher,depth,b,newHist);
+    bool hasNext = b.getWinner() == NPLA;
+    if(hasNext)
+    {
+      b.setPlaStep(gOpp(b.player),0);
+      b.refreshStartHash();
+      if(batched)
+        chunkBoards.push_back(b);
+      else
+      {
+        BoardHistory newHist = BoardHistory(b);
+        eval_t nextEval = getEvaluation(searcher,depth,b,newHist);
+        addMovesArePositive(baseEval,nextEval,posWeight,winProbScale,variance);
+      }
+    }
 
-    if(nextEval < baseEval)
+    if(batched)
     {
-      double diff = pseudoWinProbability(baseEval,winProbScale) - pseudoWinProbability(nextEval,winProbScale);
-      variance += diff * diff * posWeight;
+      chunkPosWeights.push_back(posWeight);
+      chunkHasNexts.push_back(hasNext);
+      if((int)chunkBoards.size() >= STATIC_EVAL_CHUNK)
+        flushMovesArePositiveChunk(chunkBoards,chunkPosWeights,chunkHasNexts,searcher.params.numThreads,winProbScale,variance);
     }
   }
+  if(batched)
+    flushMovesArePositiveChunk(chunkBoards,chunkPosWeights,chunkHasNexts,searcher.params.numThreads,winProbScale,variance);
+
   return variance;
 }
 
@@ -531,6 +687,7 @@ int MainFuncs::optimizeEval(int argc, const char* const *argv)
       "-tdscale scale "
       "-mapscale scale "
       "-priorscale scale "
+      "<-threads threads (default 1)>"
       "<-ratedonly>"
       "<-minrating rating>"
       "<-poskeepprop prop>"
@@ -541,9 +698,9 @@ int MainFuncs::optimizeEval(int argc, const char* const *argv)
       "<-movekeepprop prop (default 0)>"
       "<-movekeepbase const (default 1)>";
   const char* required = "winprobscale horizon depth numiters tdscale mapscale priorscale";
-  const char* allowed = "ratedonly minrating poskeepprop botkeepprop botgameweight botposweight fancyweight movekeepprop movekeepbase";
+  const char* allowed = "threads ratedonly minrating poskeepprop botkeepprop botgameweight botposweight fancyweight movekeepprop movekeepbase";
   const char* empty = "ratedonly fancyweight";
-  const char* nonempty = "winprobscale horizon depth numiters tdscale mapscale priorscale minrating poskeepprop botkeepprop botgameweight botposweight movekeepprop movekeepbase";
+  const char* nonempty = "winprobscale horizon depth numiters tdscale mapscale priorscale threads minrating poskeepprop botkeepprop botgameweight botposweight movekeepprop movekeepbase";
 
   vector<string> mainCommand = Command::parseCommand(argc, argv, usage, required, allowed, empty, nonempty);
   map<string,string> flags = Command::parseFlags(argc, argv, usage, required, allowed, empty, nonempty);
@@ -559,6 +716,7 @@ int MainFuncs::optimizeEval(int argc, const char* const *argv)
   double tdLambdaScale = Command::getDouble(flags,"tdscale");
   double movesArePositiveScale = Command::getDouble(flags,"mapscale");
   double priorScale = Command::getDouble(flags,"priorscale");
+  int numThreads = Command::getInt(flags,"threads",1);
 
   bool ratedOnly = Command::isSet(flags,"ratedonly");
   bool fancyWeight = Command::isSet(flags,"fancyweight");
@@ -598,6 +756,7 @@ int MainFuncs::optimizeEval(int argc, const char* const *argv)
 
   SearchParams params;
   initParams(params);
+  params.setNumThreads(numThreads);
   Searcher searcher(params);
 
   vector<string> names;
@@ -291,8 +291,8 @@ static bool tryGetMove(int argc, const char* const *argv)
   if(bthreads)
   {
     params.numThreads = Global::stringToInt(sthreads);
-    if(params.numThreads < 1 || params.numThreads > 256)
-      Global::fatalError("-threads: T < 1 or T > 256");
+    if(params.numThreads < 1)
+      Global::fatalError("-threads: T < 1");
   }
 
   //Hash memory
@@ -121,8 +121,10 @@ static bool handleMovesFromCommand(const vector<string>& mainCommand, vector<Boa
 
 static void applyExtraMoves(Board& board, BoardHistory& hist, const vector<move_t>& moves);
 
-static void performSingleSearch(const Board& b, const BoardHistory& hist, int depth, double time, const TimeControl& tc, const SearchParams& params);
-static void performMultiSearch(const vector<Board>& boards, const vector<BoardHistory>& hists,int depth, double time, const TimeControl& tc, const SearchParams& params);
+static void performSingleSearch(const Board& b, const BoardHistory& hist, int depth, double time, const TimeControl& tc, const SearchParams& params,
+    const string& loadHashFile, const string& saveHashFile);
+static void performMultiSearch(const vector<Board>& boards, const vector<BoardHistory>& hists,int depth, double time, const TimeControl& tc, const SearchParams& params,
+    const string& loadHashFile, const string& saveHashFile);
 
 static void performSingleEval(const Board& b, pla_t mainPla);
 static void performMultiEval(const vector<Board>& boards, pla_t mainPla);
@@ -148,6 +150,14 @@ int MainFuncs::searchPos(int argc, const char* const *argv)
       "<-m extra moves to make> "
       "<-idx idx to view in multiboard file> "
       "<-threads threads> "
+      "<-lazysmp> "
+      "<-pinthreads> "
+      "<-historymode shared|atomic|perthread> "
+      "<-aspiration root aspiration window half-width, 0 to disable> "
+      "<-multipv number of best moves to find exact evals and pvs for> "
+      "<-streamroot search cheap root moves while generating the rest> "
+      "<-lazyeval percent of the default lazy eval margins, 0 to disable> "
+      "<-lazyevalcheck count lazy evals that the full eval disagrees with> "
       "<-tc timecontrol pm/rs/%/rm/gm/pmm/au/rc/gc> "
       "<-hashmem hashmem> "
       "<-rootbias bias> "
@@ -155,15 +165,20 @@ int MainFuncs::searchPos(int argc, const char* const *argv)
       "<-nonullmove> "
       "<-noreduce> "
       "<-avoidearly> "
+      "<-noprefetch> "
+      "<-noevalcache> "
+      "<-nohashpersist> "
+      "<-loadhash file to load the hashtable from before searching> "
+      "<-savehash file to save the hashtable to after searching> "
       "<-mainpla pla> "
       "<-rdelta rdelta for randomizing>"
       "<-seed for randomizing, random if unspecified>"
       "<-exclude commaseparated list of hashes or moves to forbid>"
       "<-excludesteps commaseparated list of stepsets to forbid>";
   const char* required = "";
-  const char* allowed = "d t tc v vb ve novieweval threads m hashmem idx rootbias safeprune nonullmove noreduce avoidearly mainpla exclude excludesteps rdelta seed";
-  const char* empty = "vb ve novieweval safeprune nonullmove noreduce avoidearly";
-  const char* nonempty = "d t tc threads m hashmem idx rootbias exclude excludesteps rdelta seed mainpla";
+  const char* allowed = "d t tc v vb ve novieweval threads m hashmem idx rootbias safeprune nonullmove noreduce avoidearly noprefetch noevalcache nohashpersist loadhash savehash mainpla exclude excludesteps rdelta seed lazysmp pinthreads historymode aspiration multipv streamroot lazyeval lazyevalcheck";
+  const char* empty = "vb ve novieweval safeprune nonullmove noreduce avoidearly noprefetch noevalcache nohashpersist lazysmp pinthreads streamroot lazyevalcheck";
+  const char* nonempty = "d t tc threads m hashmem idx rootbias exclude excludesteps rdelta seed mainpla loadhash savehash historymode aspiration multipv lazyeval";
   vector<string> mainCommand = Command::parseCommand(argc, argv, usage, required, allowed, empty, nonempty);
   map<string,string> flags = Command::parseFlags(argc, argv, usage, required, allowed, empty, nonempty);
 
@@ -175,11 +190,32 @@ int MainFuncs::searchPos(int argc, const char* const *argv)
   string viewMoves = Command::getString(flags,"v","");
   bool noViewEval = Command::isSet(flags,"novieweval");
   int numThreads = Command::getInt(flags,"threads",1);
+  bool lazySMP = Command::isSet(flags,"lazysmp");
+  bool pinThreads = Command::isSet(flags,"pinthreads");
+  int aspirationWindow = Command::getInt(flags,"aspiration",SearchParams::DEFAULT_ASPIRATION_WINDOW);
+  int multiPV = Command::getInt(flags,"multipv",1);
+  bool streamRoot = Command::isSet(flags,"streamroot");
+  int lazyEvalPercent = Command::getInt(flags,"lazyeval",0);
+  bool lazyEvalCheck = Command::isSet(flags,"lazyevalcheck");
+  int historyMode = SearchParams::HISTORY_MODE_PER_THREAD;
+  if(Command::isSet(flags,"historymode"))
+  {
+    string mode = Command::getString(flags,"historymode");
+    if(mode == "shared") historyMode = SearchParams::HISTORY_MODE_SHARED;
+    else if(mode == "atomic") historyMode = SearchParams::HISTORY_MODE_ATOMIC;
+    else if(mode == "perthread") historyMode = SearchParams::HISTORY_MODE_PER_THREAD;
+    else Global::fatalError("Unknown -historymode: " + mode);
+  }
   double rootBias = Command::getDouble(flags,"rootbias",SearchParams::DEFAULT_ROOT_BIAS);
   bool safePruning = Command::isSet(flags,"safeprune");
   bool noNullMove = Command::isSet(flags,"nonullmove");
   bool noReduce = Command::isSet(flags,"noreduce");
   bool avoidEarlyStuff = Command::isSet(flags,"avoidearly");
+  bool noPrefetch = Command::isSet(flags,"noprefetch");
+  bool noEvalCache = Command::isSet(flags,"noevalcache");
+  bool noHashPersist = Command::isSet(flags,"nohashpersist");
+  string loadHashFile = Command::getString(flags,"loadhash",string());
+  string saveHashFile = Command::getString(flags,"savehash",string());
   pla_t mainPla = Command::isSet(flags,"mainpla") ? Board::readPla(Command::getString(flags,"mainpla")) : NPLA;
   bool randomize = Command::isSet(flags,"rdelta");
   int rDelta = Command::getInt(flags,"rdelta",0);
@@ -219,13 +255,24 @@ int MainFuncs::searchPos(int argc, const char* const *argv)
 
     SearchParams params;
     initParams(params,numThreads,useHashMem,hashMem,rootBias,safePruning,noNullMove,noReduce,avoidEarlyStuff,mainPla,excludes,excludeSteps,&board,randomize,rDelta,seed);
+    params.setHashPrefetch(!noPrefetch);
+    if(noEvalCache)
+      params.evalCacheExp = 0;
+    params.setHashPersist(!noHashPersist);
+    params.setLazySMP(lazySMP);
+    params.setPinThreads(pinThreads);
+    params.setHistoryMode(historyMode);
+    params.setAspirationWindow(aspirationWindow);
+    params.setMultiPV(multiPV);
+    params.setStreamRootMoves(streamRoot);
+    params.setLazyEval(lazyEvalPercent,lazyEvalCheck);
     if(doView)
     {
       params.initView(board,viewMoves,viewBetterOnly,!viewBetterOnly,viewExact);
       params.viewEvaluate = !noViewEval;
     }
 
-    performSingleSearch(board, hist, depth, time, tc, params);
+    performSingleSearch(board, hist, depth, time, tc, params, loadHashFile, saveHashFile);
   }
   else
   {
@@ -237,7 +284,18 @@ int MainFuncs::searchPos(int argc, const char* const *argv)
       Global::fatalError("Cannot use -exclude for multiple positions");
     SearchParams params;
     initParams(params,numThreads,useHashMem,hashMem,rootBias,safePruning,noNullMove,noReduce,avoidEarlyStuff,mainPla,excludes,excludeSteps,NULL,randomize,rDelta,seed);
-    performMultiSearch(boards, hists, depth, time, tc, params);
+    params.setHashPrefetch(!noPrefetch);
+    if(noEvalCache)
+      params.evalCacheExp = 0;
+    params.setHashPersist(!noHashPersist);
+    params.setLazySMP(lazySMP);
+    params.setPinThreads(pinThreads);
+    params.setHistoryMode(historyMode);
+    params.setAspirationWindow(aspirationWindow);
+    params.setMultiPV(multiPV);
+    params.setStreamRootMoves(streamRoot);
+    params.setLazyEval(lazyEvalPercent,lazyEvalCheck);
+    performMultiSearch(boards, hists, depth, time, tc, params, loadHashFile, saveHashFile);
   }
   return EXIT_SUCCESS;
 }
@@ -349,7 +407,7 @@ int MainFuncs::searchMoves(int argc, const char* const *argv)
       params.viewEvaluate = !noViewEval;
     }
 
-    performSingleSearch(board, hist, depth, time, tc, params);
+    performSingleSearch(board, hist, depth, time, tc, params, string(), string());
   }
   else
   {
@@ -361,7 +419,7 @@ int MainFuncs::searchMoves(int argc, const char* const *argv)
       Global::fatalError("Cannot use -exclude for multiple positions");
     SearchParams params;
     initParams(params,numThreads,useHashMem,hashMem,rootBias,safePruning,noNullMove,noReduce,avoidEarlyStuff,mainPla,excludes,excludeSteps,NULL,randomize,rDelta,seed);
-    performMultiSearch(boards, hists, depth, time, tc, params);
+    performMultiSearch(boards, hists, depth, time, tc, params, string(), string());
   }
   return EXIT_SUCCESS;
 }
@@ -787,7 +845,7 @@ static bool handleMovesFromCommand(const vector<string>& mainCommand, vector<Boa
 }
 
 static void performSingleSearch(const Board& b, const BoardHistory& hist, int depth, double time,
-    const TimeControl& tc, const SearchParams& params)
+    const TimeControl& tc, const SearchParams& params, const string& loadHashFile, const string& saveHashFile)
 {
   cout << b << endl;
   double min, normal, max;
@@ -796,22 +854,30 @@ static void performSingleSearch(const Board& b, const BoardHistory& hist, int de
     cout << "Base Time: " << min << "/" << normal << "/" << max << endl;
 
   Searcher searcher(params);
+  if(loadHashFile.length() > 0)
+    searcher.loadHash(loadHashFile);
   searcher.setTimeControl(tc);
   searcher.searchID(b,hist,depth,time,true);
   SearchStats::printBasic(cout,searcher.stats);
   cout << searcher.stats << endl;
+  if(saveHashFile.length() > 0)
+    searcher.saveHash(saveHashFile);
 }
 
 static void performMultiSearch(const vector<Board>& boards, const vector<BoardHistory>& hists, int depth, double time,
-    const TimeControl& tc, const SearchParams& params)
+    const TimeControl& tc, const SearchParams& params, const string& loadHashFile, const string& saveHashFile)
 {
   Searcher searcher(params);
+  if(loadHashFile.length() > 0)
+    searcher.loadHash(loadHashFile);
   searcher.setTimeControl(tc);
   for(int i = 0; i<(int)boards.size(); i++)
   {
     searcher.searchID(boards[i],hists[i],depth,time,false);
     SearchStats::printBasic(cout,searcher.stats,i);
   }
+  if(saveHashFile.length() > 0)
+    searcher.saveHash(saveHashFile);
 }
 
 static void performSingleEval(const Board& b, pla_t mainPla)
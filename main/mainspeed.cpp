@@ -3,15 +3,24 @@
  * Author: davidwu
  */
 
+#include <cmath>
+#include <algorithm>
 #include "../core/global.h"
+#include "../core/hash.h"
 #include "../core/rand.h"
 #include "../core/timer.h"
 #include "../board/board.h"
+#include "../board/boardhistory.h"
 #include "../board/boardmovegen.h"
 #include "../board/boardtrees.h"
 #include "../board/gamerecord.h"
 #include "../eval/threats.h"
 #include "../eval/eval.h"
+#include "../eval/internal.h"
+#include "../learning/learner.h"
+#include "../learning/featuremove.h"
+#include "../search/search.h"
+#include "../search/searchparams.h"
 #include "../search/searchmovegen.h"
 #include "../program/arimaaio.h"
 #include "../program/command.h"
@@ -168,7 +177,382 @@ int MainFuncs::checkSpeed(int argc, const char* const *argv)
   return EXIT_SUCCESS;
 }
 
+//Fixed positions for bench, covering the opening, quiet and tactical middlegames, and a sparse endgame
+static const char* const BENCH_POSITIONS[] = {
+  "P = 1, S = 0\n"
+  "rrrrrrrr"
+  "hdcemcdh"
+  "..*..*.."
+  "........"
+  "........"
+  "..*..*.."
+  "HDCMECDH"
+  "RRRRRRRR"
+  "\n",
 
+  "P = 0, S = 0\n"
+  "r.rr.rrr"
+  ".dc.mc.h"
+  ".h*e.*.."
+  "..d....."
+  "..E..R.."
+  "..*..*.."
+  "HDC.MCDH"
+  "RR.RRR.R"
+  "\n",
 
+  "P = 1, S = 0\n"
+  "rrr..rrr"
+  "hdc.mcdh"
+  "..*er*.."
+  "........"
+  "....E..."
+  "..*..*.."
+  "HDCM.CDH"
+  "RRRRRRRR"
+  "\n",
 
+  "P = 0, S = 0\n"
+  "r..r.r.r"
+  ".r.....r"
+  ".c*.d*.."
+  "h.em...."
+  ".....H.."
+  "..*E.*.R"
+  ".MD..C.."
+  "RRR..RRR"
+  "\n",
 
+  "P = 1, S = 0\n"
+  "rrrrrrrr"
+  "h.dme.dh"
+  "..*..*.."
+  "..E....."
+  "..c....."
+  "..*..*.."
+  "HDCM.CDH"
+  "RRRRRRRR"
+  "\n",
+
+  "P = 1, S = 0\n"
+  "r...r..."
+  "..d..e.."
+  "..*..*.."
+  "...E...."
+  ".....c.."
+  "..*..*.."
+  ".R..M..R"
+  "......R."
+  "\n",
+
+  "P = 0, S = 0\n"
+  ".r....r."
+  "...c...."
+  "..*..*.."
+  "..e..R.."
+  "...E...."
+  "..*..*.."
+  ".R..d..."
+  "....H..."
+  "\n",
+};
+
+int MainFuncs::bench(int argc, const char* const *argv)
+{
+  const char* usage =
+      "<-d depth>";
+  const char* required = "";
+  const char* allowed = "d";
+  const char* empty = "";
+  const char* nonempty = "d";
+  vector<string> mainCommand = Command::parseCommand(argc, argv, usage, required, allowed, empty, nonempty);
+  map<string,string> flags = Command::parseFlags(argc, argv, usage, required, allowed, empty, nonempty);
+  if(mainCommand.size() != 1)
+  {Command::printHelp(argc,argv,usage); return EXIT_FAILURE;}
+
+  cout << Global::concat(argv,argc," ") << endl << Command::gitRevisionId() << endl;
+
+  int depth = Command::getInt(flags,"d",8);
+
+  //Single threaded and unrandomized, with nothing carried over between positions, so that the node counts
+  //depend only on the positions and the code
+  SearchParams params;
+  BradleyTerry rootLearner = BradleyTerry::inputFromDefault(MoveFeature::getArimaaFeatureSet());
+  params.initRootMoveFeatures(rootLearner);
+  params.setRootFancyPrune(true);
+  params.setNumThreads(1);
+  params.setHashPersist(false);
+  Searcher searcher(params);
+
+  uint64_t totalNodes = 0;
+  uint64_t totalEvals = 0;
+  double totalTime = 0;
+  uint64_t signature = 0;
+  int numPositions = sizeof(BENCH_POSITIONS) / sizeof(BENCH_POSITIONS[0]);
+  cout << Global::strprintf("%-4s %12s %12s %9s %12s %7s", "Pos", "Nodes", "Evals", "Time", "NPS", "Eval") << endl;
+  for(int i = 0; i<numPositions; i++)
+  {
+    Board b = Board::read(BENCH_POSITIONS[i]);
+    BoardHistory hist(b);
+    searcher.searchID(b,hist,depth,SearchParams::AUTO_TIME,false);
+
+    const SearchStats& stats = searcher.stats;
+    uint64_t nodes = stats.mNodes + stats.qNodes;
+    cout << Global::strprintf("%-4d %12llu %12llu %9.3f %12.0f %7d", i, (unsigned long long)nodes,
+        (unsigned long long)stats.evalCalls, stats.timeTaken, nodes / max(stats.timeTaken,1e-9), stats.finalEval) << endl;
+
+    totalNodes += nodes;
+    totalEvals += stats.evalCalls;
+    totalTime += stats.timeTaken;
+    signature = Hash::murmurMix(signature + stats.mNodes);
+    signature = Hash::murmurMix(signature + stats.qNodes);
+    signature = Hash::murmurMix(signature + stats.evalCalls);
+    signature = Hash::murmurMix(signature + (uint64_t)(int64_t)stats.finalEval);
+  }
+  cout << Global::strprintf("%-4s %12llu %12llu %9.3f %12.0f", "All", (unsigned long long)totalNodes,
+      (unsigned long long)totalEvals, totalTime, totalNodes / max(totalTime,1e-9)) << endl;
+  cout << "Signature: " << Global::uint64ToHexString(signature) << endl;
+
+  return EXIT_SUCCESS;
+}
+
+//MICROBENCHMARKS------------------------------------------------------------------------------
+
+//A position in the microbenchmark corpus, along with anything precomputed for it so that only the
+//primitive itself is timed
+struct MicroBenchPos
+{
+  Board board;
+  Bitmap pStrongerMaps[2][NUMTYPES];
+  vector<step_t> steps; //Legal single steps for the player to move
+};
+
+//Each runs one primitive once on every position, adding the number of calls made to numCalls
+//and returning a checksum of the results so that the calls can't be optimized away
+typedef uint64_t (*MicroBenchFunc)(vector<MicroBenchPos>& poses, int64_t& numCalls);
+
+static uint64_t microBenchMakeUndoStep(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  UndoData udata;
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    Board& b = poses[i].board;
+    const vector<step_t>& steps = poses[i].steps;
+    int num = steps.size();
+    for(int j = 0; j<num; j++)
+    {
+      b.makeStep(steps[j],udata);
+      sum += b.sitCurrentHash;
+      b.undoStep(udata);
+    }
+    numCalls += num;
+  }
+  return sum;
+}
+
+static uint64_t microBenchGenSteps(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  move_t mv[256];
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    const Board& b = poses[i].board;
+    int num = BoardMoveGen::genSteps(b,b.player,mv);
+    sum += num + (num > 0 ? mv[num-1] : 0);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchGenPushPulls(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  move_t mv[512];
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    const Board& b = poses[i].board;
+    int num = BoardMoveGen::genPushPulls(b,b.player,mv);
+    sum += num + (num > 0 ? mv[num-1] : 0);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchCanCaps(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    Board& b = poses[i].board;
+    sum += BoardTrees::canCaps(b,b.player,4-b.step);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchGenCaps(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  move_t mv[2048];
+  int hm[2048];
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    Board& b = poses[i].board;
+    int num = BoardTrees::genCaps(b,b.player,4-b.step,mv,hm);
+    sum += num + (num > 0 ? mv[num-1] : 0);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchGoalDist(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    Board& b = poses[i].board;
+    sum += BoardTrees::goalDist(b,b.player,4);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchUFDist(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  //Off-board entries are never written
+  int ufDist[BSIZE];
+  for(int loc = 0; loc<BSIZE; loc++)
+    ufDist[loc] = 0;
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    UFDist::get(poses[i].board,ufDist,poses[i].pStrongerMaps);
+    for(int loc = 0; loc<BSIZE; loc++)
+      sum += ufDist[loc];
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+static uint64_t microBenchEvaluate(vector<MicroBenchPos>& poses, int64_t& numCalls)
+{
+  uint64_t sum = 0;
+  for(int i = 0; i<(int)poses.size(); i++)
+  {
+    Board& b = poses[i].board;
+    sum += (uint64_t)(int64_t)Eval::evaluate(b,b.player,0,NULL);
+  }
+  numCalls += poses.size();
+  return sum;
+}
+
+int MainFuncs::microBench(int argc, const char* const *argv)
+{
+  const char* usage =
+      "posfile "
+      "<-warmup passes over the positions before timing, default 3> "
+      "<-reps timed passes over the positions, default 100, with fewer p99 is just the max> "
+      "<-only commaseparated names of the primitives to run>";
+  const char* required = "";
+  const char* allowed = "warmup reps only";
+  const char* empty = "";
+  const char* nonempty = "warmup reps only";
+  vector<string> mainCommand = Command::parseCommand(argc, argv, usage, required, allowed, empty, nonempty);
+  map<string,string> flags = Command::parseFlags(argc, argv, usage, required, allowed, empty, nonempty);
+  if(mainCommand.size() != 2)
+  {Command::printHelp(argc,argv,usage); return EXIT_FAILURE;}
+
+  int numWarmup = Command::getInt(flags,"warmup",3);
+  int numReps = Command::getInt(flags,"reps",100);
+  if(numWarmup < 0 || numReps < 1)
+    Global::fatalError("microBench: need warmup >= 0 and reps >= 1");
+  vector<string> only;
+  if(Command::isSet(flags,"only"))
+  {
+    only = Global::split(Command::getString(flags,"only"),',');
+    for(int i = 0; i<(int)only.size(); i++)
+      only[i] = Global::trim(only[i]);
+  }
+
+  vector<Board> boards = ArimaaIO::readBoardFile(mainCommand[1]);
+  vector<MicroBenchPos> poses(boards.size());
+  for(int i = 0; i<(int)boards.size(); i++)
+  {
+    poses[i].board = boards[i];
+    boards[i].initializeStrongerMaps(poses[i].pStrongerMaps);
+    move_t mv[256];
+    int num = BoardMoveGen::genSteps(boards[i],boards[i].player,mv);
+    for(int j = 0; j<num; j++)
+      poses[i].steps.push_back(getStep(mv[j],0));
+  }
+  if(poses.size() == 0)
+    Global::fatalError("microBench: no positions in " + mainCommand[1]);
+
+  const int numFuncs = 8;
+  const char* names[numFuncs] = {
+    "makeStepUndoStep", "genSteps", "genPushPulls", "canCaps", "genCaps", "goalDist", "ufDist", "evaluate"
+  };
+  MicroBenchFunc funcs[numFuncs] = {
+    &microBenchMakeUndoStep, &microBenchGenSteps, &microBenchGenPushPulls, &microBenchCanCaps,
+    &microBenchGenCaps, &microBenchGoalDist, &microBenchUFDist, &microBenchEvaluate
+  };
+
+  //The clock is too coarse to time a single pass over a small corpus, so each timed rep makes as many passes
+  //as the warmup found to take at least this long
+  const double minRepSeconds = 0.002;
+
+  //JSON on stdout, one object per primitive with times in nanoseconds per call
+  cout << "{" << endl;
+  cout << "  \"revision\": \"" << Command::gitRevisionId() << "\"," << endl;
+  cout << "  \"positions\": " << poses.size() << "," << endl;
+  cout << "  \"warmup\": " << numWarmup << "," << endl;
+  cout << "  \"reps\": " << numReps << "," << endl;
+  cout << "  \"primitives\": [";
+  bool first = true;
+  ClockTimer timer;
+  for(int f = 0; f<numFuncs; f++)
+  {
+    if(only.size() > 0 && std::find(only.begin(),only.end(),string(names[f])) == only.end())
+      continue;
+
+    uint64_t checksum = 0;
+    int64_t numCalls = 0;
+    for(int r = 0; r<numWarmup; r++)
+      checksum += funcs[f](poses,numCalls);
+
+    int passesPerRep = 1;
+    while(true)
+    {
+      timer.reset();
+      for(int p = 0; p<passesPerRep; p++)
+        checksum += funcs[f](poses,numCalls);
+      if(timer.getSeconds() >= minRepSeconds || passesPerRep >= (1 << 20))
+        break;
+      passesPerRep *= 2;
+    }
+
+    vector<double> nsPerCall(numReps);
+    for(int r = 0; r<numReps; r++)
+    {
+      numCalls = 0;
+      timer.reset();
+      for(int p = 0; p<passesPerRep; p++)
+        checksum += funcs[f](poses,numCalls);
+      double seconds = timer.getSeconds();
+      nsPerCall[r] = numCalls > 0 ? seconds * 1e9 / numCalls : 0;
+    }
+    std::sort(nsPerCall.begin(),nsPerCall.end());
+    double median = nsPerCall[numReps/2];
+    double p99 = nsPerCall[min(numReps-1,(int)ceil(numReps * 0.99)-1)];
+
+    cout << (first ? "" : ",") << endl;
+    cout << Global::strprintf("    {\"name\": \"%s\", \"passesPerRep\": %d, \"callsPerRep\": %lld, \"medianNs\": %.2f, \"p99Ns\": %.2f, \"minNs\": %.2f, \"checksum\": \"%s\"}",
+        names[f], passesPerRep, (long long)numCalls, median, p99, nsPerCall[0], Global::uint64ToHexString(checksum).c_str());
+    first = false;
+  }
+  cout << endl << "  ]" << endl;
+  cout << "}" << endl;
+
+  return EXIT_SUCCESS;
+}
@@ -467,15 +467,116 @@ static void runAsyncBotThreadTests(const vector<Board>& boards)
   cout << "Yay, all done" << endl;
 }
 
+//Search each position to a fixed depth with splitpoint parallelism and then with lazy SMP, comparing the two
+static void runLazySMPComparison(const vector<Board>& boards, int numThreads, int depth)
+{
+  int numBoards = boards.size();
+  double totalTime[2] = {0,0};
+  uint64_t totalNodes[2] = {0,0};
+  for(int mode = 0; mode < 2; mode++)
+  {
+    bool lazySMP = mode == 1;
+    cout << "Searching each position to depth " << depth << " with " << numThreads << " threads using "
+         << (lazySMP ? "lazy SMP" : "splitpoints") << "..." << endl;
+
+    SearchParams params;
+    setDefaultParams(params);
+    params.setNumThreads(numThreads);
+    params.setLazySMP(lazySMP);
+    //Each position should be searched from scratch, so that the modes are compared fairly
+    params.setHashPersist(false);
+    Searcher searcher(params);
+
+    for(int i = 0; i<numBoards; i++)
+    {
+      const Board& b = boards[i];
+      BoardHistory hist(b);
+      searcher.searchID(b,hist,depth,SearchParams::AUTO_TIME,false);
+      const SearchStats& stats = searcher.stats;
+      uint64_t nodes = stats.mNodes + stats.qNodes;
+      cout << Global::strprintf("Pos %3d Time %7.3f Nodes %11llu Eval %6d PV ", i, stats.timeTaken,
+          (unsigned long long)nodes, (int)stats.finalEval) << stats.pvString << endl;
+      totalTime[mode] += stats.timeTaken;
+      totalNodes[mode] += nodes;
+    }
+  }
+  cout << Global::strprintf("Splitpoints total time %.3f nodes %llu", totalTime[0], (unsigned long long)totalNodes[0]) << endl;
+  cout << Global::strprintf("Lazy SMP    total time %.3f nodes %llu", totalTime[1], (unsigned long long)totalNodes[1]) << endl;
+  if(totalTime[1] > 0)
+    cout << Global::strprintf("Lazy SMP time-to-depth speedup over splitpoints: %.3f", totalTime[0] / totalTime[1]) << endl;
+}
+
+//Search each position to a fixed depth with 1, 2, 4, ... up to maxThreads threads, reporting how the time to depth,
+//nodes and nps scale relative to one thread, along with the splitpoint work sharing stats that explain the overhead
+static void runThreadScaling(const vector<Board>& boards, int maxThreads, int depth)
+{
+  if(maxThreads < 1)
+    Global::fatalError("runThreadScaling: threads must be at least 1");
+  vector<int> threadCounts;
+  for(int n = 1; n < maxThreads; n *= 2)
+    threadCounts.push_back(n);
+  threadCounts.push_back(maxThreads);
+
+  int numBoards = boards.size();
+  int numCounts = threadCounts.size();
+  vector<double> totalTime(numCounts,0);
+  vector<uint64_t> totalNodes(numCounts,0);
+  vector<SearchStats> totalStats(numCounts);
+  for(int c = 0; c < numCounts; c++)
+  {
+    int numThreads = threadCounts[c];
+    cout << "Searching each position to depth " << depth << " with " << numThreads << " threads..." << endl;
+
+    SearchParams params;
+    setDefaultParams(params);
+    params.setNumThreads(numThreads);
+    //Each position should be searched from scratch, so that the thread counts are compared fairly
+    params.setHashPersist(false);
+    Searcher searcher(params);
+
+    for(int i = 0; i<numBoards; i++)
+    {
+      const Board& b = boards[i];
+      BoardHistory hist(b);
+      searcher.searchID(b,hist,depth,SearchParams::AUTO_TIME,false);
+      const SearchStats& stats = searcher.stats;
+      uint64_t nodes = stats.mNodes + stats.qNodes;
+      cout << Global::strprintf("Pos %3d Time %7.3f Nodes %11llu Eval %6d PV ", i, stats.timeTaken,
+          (unsigned long long)nodes, (int)stats.finalEval) << stats.pvString << endl;
+      totalTime[c] += stats.timeTaken;
+      totalNodes[c] += nodes;
+      totalStats[c] += stats;
+    }
+  }
+
+  //Speedup is in time to depth, and node overhead is how many more nodes it took than one thread to get there
+  cout << Global::strprintf("%7s %9s %8s %6s %12s %8s %12s %8s %10s %8s %10s %10s",
+      "Threads", "Time", "Speedup", "Effic", "Nodes", "NodeOvh", "NPS", "NPSScale",
+      "PubWorkReq", "AvgDepth", "ThrAborts", "AbortBrs") << endl;
+  double baseNps = totalNodes[0] / max(totalTime[0],1e-9);
+  for(int c = 0; c < numCounts; c++)
+  {
+    const SearchStats& stats = totalStats[c];
+    double speedup = totalTime[0] / max(totalTime[c],1e-9);
+    double nps = totalNodes[c] / max(totalTime[c],1e-9);
+    cout << Global::strprintf("%7d %9.3f %8.3f %6.3f %12llu %8.3f %12.0f %8.3f %10lld %8.2f %10lld %10lld",
+        threadCounts[c], totalTime[c], speedup, speedup / threadCounts[c], (unsigned long long)totalNodes[c],
+        (double)totalNodes[c] / max(totalNodes[0],(uint64_t)1), nps, nps / max(baseNps,1e-9),
+        (long long)stats.publicWorkRequests,
+        stats.publicWorkRequests == 0 ? 0.0 : (double)stats.publicWorkDepthSum / stats.publicWorkRequests,
+        (long long)stats.threadAborts, (long long)stats.abortedBranches) << endl;
+  }
+}
 
 int MainFuncs::runThreadTests(int argc, const char* const *argv)
 {
   const char* usage =
-      "posfile <-searcher> <-asyncbot>";
+      "posfile <-searcher> <-asyncbot> <-lazysmp (compare against splitpoints)> <-scaling (1,2,4... up to -threads)> "
+      "<-threads N (default 4)> <-d depth (default 8)>";
   const char* required = "";
-  const char* allowed = "searcher asyncbot";
-  const char* empty = "searcher asyncbot";
-  const char* nonempty = "";
+  const char* allowed = "searcher asyncbot lazysmp scaling threads d";
+  const char* empty = "searcher asyncbot lazysmp scaling";
+  const char* nonempty = "threads d";
   vector<string> mainCommand = Command::parseCommand(argc, argv, usage, required, allowed, empty, nonempty);
   map<string,string> flags = Command::parseFlags(argc, argv, usage, required, allowed, empty, nonempty);
   if(mainCommand.size() <= 1)
@@ -483,9 +584,10 @@ int MainFuncs::runThreadTests(int argc, const char* const *argv)
 
   vector<Board> boards = ArimaaIO::readBoardFile(mainCommand[1]);
 
-  if(!Command::isSet(flags,"searcher") && !Command::isSet(flags,"asyncbot"))
+  if(!Command::isSet(flags,"searcher") && !Command::isSet(flags,"asyncbot") && !Command::isSet(flags,"lazysmp") &&
+     !Command::isSet(flags,"scaling"))
   {
-    cout << "Please specify either -searcher or -asynbot to test" << endl;
+    cout << "Please specify -searcher, -asynbot, -lazysmp, or -scaling to test" << endl;
     {Command::printHelp(argc,argv,usage); return EXIT_FAILURE;}
   }
 
@@ -493,6 +595,10 @@ int MainFuncs::runThreadTests(int argc, const char* const *argv)
     runSearcherThreadTests(boards);
   if(Command::isSet(flags,"asyncbot"))
     runAsyncBotThreadTests(boards);
+  if(Command::isSet(flags,"lazysmp"))
+    runLazySMPComparison(boards,Command::getInt(flags,"threads",4),Command::getInt(flags,"d",8));
+  if(Command::isSet(flags,"scaling"))
+    runThreadScaling(boards,Command::getInt(flags,"threads",4),Command::getInt(flags,"d",8));
   return EXIT_SUCCESS;
 }
 
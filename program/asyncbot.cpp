@@ -382,4 +382,22 @@ void AsyncBot::stop()
   stopInternal(lock);
 }
 
+void AsyncBot::saveHash(const string& file)
+{
+  std::lock_guard<std::mutex> userLock(userMutex);
+  std::unique_lock<std::mutex> lock(mutex);
+  stopInternal(lock);
+  searcher.saveHash(file);
+}
+
+int AsyncBot::loadHash(const string& file)
+{
+  std::lock_guard<std::mutex> userLock(userMutex);
+  std::unique_lock<std::mutex> lock(mutex);
+  stopInternal(lock);
+  searcher.loadHash(file);
+  params.mainHashExp = searcher.params.mainHashExp;
+  return params.mainHashExp;
+}
+
 
@@ -85,6 +85,12 @@ class AsyncBot
   //may be called prior to stop returning).
   void stop();
 
+  //Interrupt any previous search or ponder, and then save the search hashtable to a file,
+  //or replace it with one loaded from a file. Loading returns the exponent of the loaded table,
+  //which is also stored into the params used for future searches.
+  void saveHash(const string& file);
+  int loadHash(const string& file);
+
   //INTERNAL USE ONLY
   void runSearchThread();
   void stopInternal(std::unique_lock<std::mutex>& lock);
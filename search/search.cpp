@@ -6,6 +6,7 @@
 
 #include <cmath>
 #include <algorithm>
+#include <functional>
 #include <ctime>
 #include "../core/global.h"
 #include "../core/boostthread.h"
@@ -19,10 +20,12 @@
 #include "../search/search.h"
 #include "../search/searchparams.h"
 #include "../search/searchutils.h"
+#include "../search/searchhistory.h"
 #include "../search/searchmovegen.h"
 #include "../search/searchthread.h"
 #include "../search/timecontrol.h"
 #include "../search/searchflags.h"
+#include "../search/searchprofile.h"
 #include "../program/arimaaio.h"
 #include "../program/init.h"
 
@@ -46,15 +49,21 @@ void Searcher::init()
 {
   doOutput = false;
   mainPla = NPLA;
-  fullMoveHash = new ExistsHashTable(params.fullMoveHashExp);
+  prepareFullMoveHashes(1);
 
   int pvArraySize = SearchParams::PV_ARRAY_SIZE;
   idpv = new move_t[pvArraySize];
   idpvLen = 0;
 
-  mainHash = new SearchHashTable(params.mainHashExp);
+  mainHash = new SearchHashTable(params.mainHashExp,params.numThreads);
+  evalCache = params.evalCacheExp > 0 ? new EvalCache(params.evalCacheExp) : NULL;
 
   searchTree = NULL;
+  history = new HistoryTable();
+
+  lazyPool = NULL;
+  lazyMaster = NULL;
+  lazyDepthOffset = 0;
 
   timeLock = new SimpleLock();
   searchId = 0;
@@ -76,12 +85,18 @@ void Searcher::init()
 
 Searcher::~Searcher()
 {
-  delete fullMoveHash;
+  delete lazyPool;
+  for(int i = 0; i<(int)fullMoveHashes.size(); i++)
+    delete fullMoveHashes[i];
   delete[] idpv;
-  delete mainHash;
+  //Lazy SMP helpers only borrow these from their master
+  if(lazyMaster == NULL)
+  {
+    delete mainHash;
+    delete evalCache;
+  }
 
-  for(int i = 0; i<(int)historyTable.size(); i++)
-    delete[] historyTable[i];
+  delete history;
 
   delete searchTree;
   delete timeLock;
@@ -90,16 +105,46 @@ Searcher::~Searcher()
 
 void Searcher::resizeHashIfNeeded()
 {
-  if(fullMoveHash->exponent != params.fullMoveHashExp)
-  {
-    delete fullMoveHash;
-    fullMoveHash = new ExistsHashTable(params.fullMoveHashExp);
-  }
+  prepareFullMoveHashes(min(params.numThreads,SearchParams::MAX_ROOT_MOVEGEN_THREADS));
   if(mainHash->exponent != params.mainHashExp)
   {
     delete mainHash;
-    mainHash = new SearchHashTable(params.mainHashExp);
+    mainHash = new SearchHashTable(params.mainHashExp,params.numThreads);
   }
+  int evalCacheExp = evalCache == NULL ? 0 : evalCache->exponent;
+  if(evalCacheExp != params.evalCacheExp)
+  {
+    delete evalCache;
+    evalCache = params.evalCacheExp > 0 ? new EvalCache(params.evalCacheExp) : NULL;
+  }
+}
+
+void Searcher::becomeLazyHelper(Searcher* master, int depthOffset)
+{
+  if(lazyMaster == NULL)
+  {
+    delete mainHash;
+    delete evalCache;
+  }
+  lazyMaster = master;
+  lazyDepthOffset = depthOffset;
+  mainHash = master->mainHash;
+  evalCache = master->evalCache;
+  params.mainHashExp = master->params.mainHashExp;
+  params.evalCacheExp = master->params.evalCacheExp;
+}
+
+void Searcher::saveHash(const string& file)
+{
+  mainHash->save(file);
+}
+
+void Searcher::loadHash(const string& file)
+{
+  SearchHashTable* loaded = SearchHashTable::load(file,params.numThreads);
+  delete mainHash;
+  mainHash = loaded;
+  params.mainHashExp = mainHash->exponent;
 }
 
 //ID AND TOP LEVEL SEARCH-----------------------------------------------------------------
@@ -189,6 +234,11 @@ void Searcher::getSortedRootMoves(vector<move_t>& buf)
     buf.push_back(fullMoves[i].move);
 }
 
+vector<RootPV> Searcher::getMultiPV()
+{
+  return multiPV;
+}
+
 int Searcher::getNumRootMoves()
 {
   return (int)fullMoves.size();
@@ -225,6 +275,19 @@ void Searcher::interruptExternal(int s)
   timeLock->unlock();
 }
 
+//ASPIRATION--------------------------------------------------------------------------
+
+//Aspiration bounds that would reach the range of evals that extraeval can't affect are opened up fully,
+//since evals out there are wins, losses, or near them and can jump arbitrarily between iterations
+static eval_t aspirationAlpha(eval_t alpha)
+{
+  return alpha <= -Eval::EXTRA_EVAL_MAX_RANGE ? Eval::LOSE-1 : alpha;
+}
+static eval_t aspirationBeta(eval_t beta)
+{
+  return beta >= Eval::EXTRA_EVAL_MAX_RANGE ? Eval::WIN+1 : beta;
+}
+
 //Iterative deepening search-------------------------------------------------------------
 void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth, double seconds, bool output)
 {
@@ -256,6 +319,7 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
   mainUndoData = vector<UndoMoveData>(); //TODO rewrite maybe can eliminate boardhistory in place of this, with this containing the history from the start of the game...?
   stats = SearchStats();
   fullMoves.clear(); //If we end up exiting before we generate root moves
+  multiPV.clear();
 
   SearchUtils::endPV(idpvLen);
 
@@ -265,6 +329,10 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
       + SearchParams::MAX_MSEARCH_CDEPTH_OVER_NOMINAL;
   int maxCDepth = maxMSearchCDepth + SearchParams::QMAX_CDEPTH;
 
+  //In lazy SMP mode, the search tree is for this thread alone, and helper searches run alongside
+  bool useLazySMP = params.lazySMP && params.numThreads > 1 && lazyMaster == NULL;
+  int numTreeThreads = useLazySMP ? 1 : params.numThreads;
+
   //If we got interrupted prior to even entering this function, the searchIds will still match
   //and we will discover it normally during a timeout/interrupt check during search.
   didInterruptOrTimeout = false;
@@ -276,9 +344,18 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
   updateDesiredTime(Eval::LOSE,0,0);
   currentIterDepth = startDepth;
 
-  mainHash->clear();
-  SearchUtils::ensureHistory(historyTable,historyMax,maxMSearchCDepth);
-  SearchUtils::clearHistory(historyTable,historyMax);
+  //Lazy SMP helpers share the master's hashtable, which the master has already prepared for this search
+  if(lazyMaster == NULL)
+    mainHash->newSearch(getEvalContextHash(),params.hashPersist);
+  if(doOutput && !mainHash->allocReported)
+  {
+    (*params.output) << Global::strprintf("Hashtable: 2^%d entries, %.0f MB, %s, allocated in %.3f s",
+        mainHash->exponent, (double)(mainHash->numBuckets * sizeof(SearchHashBucket)) / 1048576.0,
+        LargeAlloc::pageTypeName(mainHash->pageType), mainHash->allocSeconds) << endl;
+    mainHash->allocReported = true;
+  }
+  history->init(params.historyMode,numTreeThreads,maxMSearchCDepth);
+  history->clear();
 
   //Check if the game is over. If so, we're done!
   eval_t gameEndVal = SearchUtils::checkGameEndConditions(b,hist,0);
@@ -289,16 +366,16 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
     return;
   }
 
+  //Stream the root moves only for whole turns, the candidates being whole turns, and not in lazy SMP helpers,
+  //which would only be racing the master to the same early pv
+  bool streamRoot = params.streamRootMoves && maxDepth > 0 && startDepth == nsInTurn &&
+      params.excludeRootStepSets.size() == 0 && lazyMaster == NULL;
+
   //Normal main search root move gen
-  if(maxDepth > 0)
+  if(maxDepth > 0 && !streamRoot)
   {
-    //Generate moves
     vector<move_t> mvVec;
-    SearchMoveGen::genFullMoves(b, mainBoardHistory, mvVec, startDepth, true, params.rootMaxNonRelTactics,
-        fullMoveHash, &params.excludeRootMoves, &params.excludeRootStepSets);
-
-    if(params.randomize)
-      SearchUtils::shuffle(params.randSeed,mvVec);
+    genRootMoves(b,startDepth,mvVec,params.numThreads);
 
     mainCheckTime();
     if(didInterruptOrTimeout)
@@ -307,43 +384,7 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
       return;
     }
 
-    //BT MOVE ORDERING----------------
-    if(params.rootMoveFeatureSet.fset != NULL && !params.stupidPrune && maxDepth >= 4)
-    {
-      DEBUGASSERT(mainBoardHistory.maxTurnBoardNumber == mainBoardHistory.maxTurnNumber);
-      Board copy = b;
-      void* moveFeatureData = params.rootMoveFeatureSet.getPosData(copy,mainBoardHistory,mainPla);
-      vector<double> featureWeights;
-      params.rootMoveFeatureSet.getFeatureWeights(moveFeatureData,params.rootMoveFeatureWeights,featureWeights);
-
-      //Sort moves!
-      size_t size = mvVec.size();
-      UndoMoveData uData;
-      fullMoves.resize(size);
-      for(size_t m = 0; m < size; m++)
-      {
-        move_t move = mvVec[m];
-        copy.makeMove(move,uData);
-        fullMoves[m].move = move;
-        fullMoves[m].val = params.rootMoveFeatureSet.getFeatureSum(
-            copy,moveFeatureData,mainPla,move,mainBoardHistory,featureWeights);
-        copy.undoMove(uData);
-      }
-      params.rootMoveFeatureSet.freePosData(moveFeatureData);
-
-      std::stable_sort(fullMoves.begin(),fullMoves.end());
-    }
-    else
-    {
-      size_t size = mvVec.size();
-      fullMoves.resize(size);
-      for(size_t m = 0; m < size; m++)
-      {
-        move_t move = mvVec[m];
-        fullMoves[m].move = move;
-        fullMoves[m].val = 0;
-      }
-    }
+    orderRootMoves(b,maxDepth,mvVec,fullMoves,params.numThreads);
 
     mainCheckTime();
     if(didInterruptOrTimeout)
@@ -353,26 +394,91 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
     }
   }
 
-  //Initialize search tree, which also spawns off threads ready to help when the search starts
-  DEBUGASSERT(searchTree == NULL);
-  searchTree = new SearchTree(this, params.numThreads, maxMSearchCDepth, maxCDepth, b, mainBoardHistory, mainUndoData);
+  //In lazy SMP mode, begin the helper searches, which run independently and feed us only through the hashtables
+  if(useLazySMP)
+  {
+    if(lazyPool != NULL && lazyPool->getNumHelpers() != params.numThreads-1)
+    {delete lazyPool; lazyPool = NULL;}
+    if(lazyPool == NULL)
+      lazyPool = new LazySMPPool(this,params.numThreads-1);
+    lazyPool->start(b,hist,maxDepth);
+  }
 
-  eval_t alpha = Eval::LOSE-1;
-  eval_t beta = Eval::WIN+1;
+  //Initialize search tree, reusing the one from the previous search along with its already-running threads
+  //and buffers if it's big enough. A new one spawns off threads ready to help when the search starts
+  if(searchTree != NULL && !searchTree->canReuse(numTreeThreads, maxMSearchCDepth, maxCDepth, params.pinThreads))
+  {delete searchTree; searchTree = NULL;}
+  if(searchTree == NULL)
+    searchTree = new SearchTree(this, numTreeThreads, maxMSearchCDepth, maxCDepth, params.pinThreads);
+  searchTree->beginSearch(b, mainBoardHistory, mainUndoData);
 
   //Qsearch directly if the depth is negative
   if(maxDepth <= 0)
   {
-    directQSearch(maxDepth,alpha,beta);
+    directQSearch(maxDepth,Eval::LOSE-1,Eval::WIN+1);
   }
   else
   {
+    if(streamRoot)
+      searchStreamedRootMoves(b,startDepth,maxDepth);
+
     //Iteratively search deeper
-    for(int depth = startDepth; depth <= maxDepth; depth++)
+    int firstDepth = min(startDepth+lazyDepthOffset,maxDepth);
+    for(int depth = firstDepth; depth <= maxDepth && !didInterruptOrTimeout; depth++)
     {
       currentIterDepth = depth;
+
+      //Search within an aspiration window around the last iteration's eval, if it wasn't a proven result.
+      //Not in multi-pv search, where the window would have to reach below every one of the best moves.
+      eval_t alpha = Eval::LOSE-1;
+      eval_t beta = Eval::WIN+1;
+      eval_t window = params.aspirationWindow;
+      if(window > 0 && params.multiPV <= 1 && depth > firstDepth && depth >= SearchParams::ASPIRATION_MIN_DEPTH &&
+         !SearchUtils::isTerminalEval(stats.finalEval))
+      {
+        alpha = aspirationAlpha(stats.finalEval - window);
+        beta = aspirationBeta(stats.finalEval + window);
+      }
+
       int numFinished = 0;
-      fsearch(depth*SearchParams::DEPTH_DIV,alpha,beta,numFinished,briefLastDepth && depth == maxDepth);
+      while(true)
+      {
+        //A fail low leaves only an upper bound and an arbitrary pv, so remember the last real result
+        eval_t prevEval = stats.finalEval;
+        double prevDepthReached = stats.depthReached;
+        string prevPVString = stats.pvString;
+        vector<move_t> prevPV = getIDPV();
+
+        fsearch(depth*SearchParams::DEPTH_DIV,alpha,beta,numFinished,briefLastDepth && depth == maxDepth);
+
+        eval_t eval = stats.finalEval;
+        bool failLow = numFinished > 0 && alpha > Eval::LOSE-1 && eval <= alpha;
+        bool failHigh = numFinished > 0 && beta < Eval::WIN+1 && eval >= beta;
+        if(failLow)
+        {
+          stats.finalEval = prevEval;
+          stats.depthReached = prevDepthReached;
+          stats.pvString = prevPVString;
+          SearchUtils::copyPV(prevPV.data(),prevPV.size(),idpv,idpvLen);
+        }
+        if(didInterruptOrTimeout || (!failLow && !failHigh))
+          break;
+
+        //Widen the side that failed and search again
+        stats.aspirationFails++;
+        window *= SearchParams::ASPIRATION_GROWTH;
+        if(failLow)
+          alpha = aspirationAlpha(eval - window);
+        else
+          beta = aspirationBeta(eval + window);
+
+        if(doOutput)
+        {
+          string evalString = ArimaaIO::writeEval(eval);
+          (*params.output) << Global::strprintf("Aspiration fail %s at depth %d Eval: %s, re-searching",
+              failLow ? "low" : "high", depth, evalString.c_str()) << endl;
+        }
+      }
 
       //Update parameters for time and do an additional time check using the time bound for the next depth
       //so that we don't start if it we're only going to quit immediately, or worse, just after one move searched.
@@ -411,15 +517,18 @@ void Searcher::searchID(const Board& b, const BoardHistory& hist, int maxDepth,
 
       //Decay the history tables if there's going to be another iteration
       if(depth < maxDepth)
-        SearchUtils::decayHistory(historyTable,historyMax);
+        history->decay();
     }
   }
 
-  //The whole search is done. The search tree destructor signals and waits for the helper threads to
-  //terminate completely
+  //The whole search is done. The search tree is kept for the next search, with its helper threads
+  //parked in the holding bay. Its destructor signals and waits for them to terminate completely.
   DEBUGASSERT(searchTree != NULL);
-  delete searchTree;
-  searchTree = NULL;
+  searchTree->endSearch();
+
+  //Stop any lazy SMP helpers and count their work as ours
+  if(useLazySMP)
+    lazyPool->stop(stats);
 
   //Update data
   stats.timeTaken = clockTimer.getSeconds();
@@ -454,6 +563,11 @@ void Searcher::fsearch(int rDepth4, eval_t alpha, eval_t beta, int& numFinished,
   spt->init(NULL,0,ERRMOVE,SplitPoint::MODE_NORMAL,b.turnNumber*4+b.step,b.step == 0,false,0,
       cDepth,rDepth4,b.sitCurrentHash,alpha,beta,0,true,ERRMOVE,KillerEntry(),false,fullNumMoves,curThread->id);
   genFSearchMoves(spt,briefLastDepth);
+  if(params.multiPV > 1)
+  {
+    rootPVs.assign(fullNumMoves,vector<move_t>());
+    rootBestEvals.clear();
+  }
   Board copy = b;
   maybeComputePosData(copy,curThread->boardHistory,rDepth4,curThread);
 
@@ -472,13 +586,18 @@ void Searcher::fsearch(int rDepth4, eval_t alpha, eval_t beta, int& numFinished,
       SearchUtils::copyPV(spt->pv,spt->pvLen,idpv,idpvLen);
       stats.pvString = Board::writeMoves(b,getIDPV());
       stats.depthReached = rDepth4/SearchParams::DEPTH_DIV - 1 + (double)numFinished/spt->numMoves;
+      if(stats.firstPVTime == 0)
+        stats.firstPVTime = clockTimer.getSeconds();
     }
 
-    if(numFinished == spt->numMoves)
+    //Reorder moves based on what was best, unless every move failed low against an aspiration window, in which
+    //case the evals are only upper bounds and the previous order is a better guess
+    if(numFinished == spt->numMoves && spt->bestEval > alpha)
     {
-      //Reorder moves based on what was best
       //Relies on searchthread copying evals back at the root in reportResult
       DEBUGASSERT(spt->numMoves == fullNumMoves);
+      if(params.multiPV > 1)
+        setMultiPV(spt->hm,fullNumMoves);
       SearchUtils::insertionSort(fullMoves,spt->hm);
     }
   }
@@ -486,6 +605,188 @@ void Searcher::fsearch(int rDepth4, eval_t alpha, eval_t beta, int& numFinished,
   searchTree->freeRootNode(spt);
 }
 
+void Searcher::prepareFullMoveHashes(int numMoveGenThreads)
+{
+  //Each thread only sees its share of the moves, so halve the size for each doubling of threads
+  int exp = params.fullMoveHashExp;
+  for(int n = 2; n <= numMoveGenThreads && exp > 14; n *= 2)
+    exp--;
+
+  if((int)fullMoveHashes.size() == numMoveGenThreads && fullMoveHashes[0]->exponent == exp)
+    return;
+  for(int i = 0; i<(int)fullMoveHashes.size(); i++)
+    delete fullMoveHashes[i];
+  fullMoveHashes.clear();
+  for(int i = 0; i<numMoveGenThreads; i++)
+    fullMoveHashes.push_back(new ExistsHashTable(exp));
+}
+
+void Searcher::genRootMoves(const Board& b, int startDepth, vector<move_t>& mvVec, int numThreads)
+{
+  //The hashtables stay sized for the full thread count, so that using fewer threads here doesn't reallocate them
+  int numMoveGenThreads = min(params.numThreads,SearchParams::MAX_ROOT_MOVEGEN_THREADS);
+  prepareFullMoveHashes(numMoveGenThreads);
+  numMoveGenThreads = max(1,min(numThreads,numMoveGenThreads));
+  SearchMoveGen::genFullMoves(b, mainBoardHistory, mvVec, startDepth, true, params.rootMaxNonRelTactics,
+      fullMoveHashes.data(), numMoveGenThreads, &params.excludeRootMoves, &params.excludeRootStepSets);
+
+  if(params.randomize)
+    SearchUtils::shuffle(params.randSeed,mvVec);
+}
+
+void Searcher::orderRootMoves(const Board& b, int maxDepth, const vector<move_t>& mvVec, vector<RatedMove>& moves,
+    int numThreads)
+{
+  //BT MOVE ORDERING----------------
+  if(params.rootMoveFeatureSet.fset != NULL && !params.stupidPrune && maxDepth >= 4)
+  {
+    DEBUGASSERT(mainBoardHistory.maxTurnBoardNumber == mainBoardHistory.maxTurnNumber);
+    Board copy = b;
+    void* moveFeatureData = params.rootMoveFeatureSet.getPosData(copy,mainBoardHistory,mainPla);
+    vector<double> featureWeights;
+    params.rootMoveFeatureSet.getFeatureWeights(moveFeatureData,params.rootMoveFeatureWeights,featureWeights);
+
+    //Sort moves!
+    size_t size = mvVec.size();
+    vector<double> vals(size);
+    params.rootMoveFeatureSet.getFeatureSums(copy,moveFeatureData,mainPla,mvVec.data(),size,
+        mainBoardHistory,featureWeights,vals.data(),numThreads);
+    moves.resize(size);
+    for(size_t m = 0; m < size; m++)
+    {
+      moves[m].move = mvVec[m];
+      moves[m].val = vals[m];
+    }
+    params.rootMoveFeatureSet.freePosData(moveFeatureData);
+
+    std::stable_sort(moves.begin(),moves.end());
+  }
+  else
+  {
+    size_t size = mvVec.size();
+    moves.resize(size);
+    for(size_t m = 0; m < size; m++)
+    {
+      move_t move = mvVec[m];
+      moves[m].move = move;
+      moves[m].val = 0;
+    }
+  }
+}
+
+void Searcher::genAndOrderRootMoves(const Board* b, int startDepth, int maxDepth, vector<RatedMove>* moves)
+{
+  //All of the search threads are busy with the candidates meanwhile, so more threads would only oversubscribe
+  vector<move_t> mvVec;
+  genRootMoves(*b,startDepth,mvVec,1);
+  orderRootMoves(*b,maxDepth,mvVec,*moves,1);
+}
+
+void Searcher::searchStreamedRootMoves(const Board& b, int startDepth, int maxDepth)
+{
+  //Nothing here touches fullMoves or the time state, so the search can proceed alongside
+  vector<RatedMove> allMoves;
+  std::thread genThread(&Searcher::genAndOrderRootMoves,this,&b,startDepth,maxDepth,&allMoves);
+
+  //Follow the hashtable's best moves through the turn, in case it kept them from a previous search
+  Board chainBoard = b;
+  move_t hashChainMove = ERRMOVE;
+  int chainLen = 0;
+  while(chainBoard.player == b.player)
+  {
+    move_t hashMove;
+    eval_t hashEval;
+    int16_t hashDepth;
+    flag_t hashFlag;
+    if(!mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,chainBoard,chainLen,false) || hashMove == ERRMOVE)
+      break;
+    hashMove = SearchUtils::convertQPassesToPasses(hashMove);
+    int ns = numStepsInMove(hashMove);
+    if(chainLen + ns > 4-b.step || !chainBoard.makeMoveLegalNoUndo(hashMove))
+      break;
+    hashChainMove = concatMoves(hashChainMove,hashMove,chainLen);
+    chainLen += ns;
+  }
+  if(chainBoard.player == b.player)
+    hashChainMove = ERRMOVE;
+
+  vector<move_t> candidates;
+  SearchMoveGen::genQuickFullMoves(b,mainBoardHistory,candidates,hashChainMove,&params.excludeRootMoves);
+  int numCandidates = candidates.size();
+  fullMoves.resize(numCandidates);
+  for(int m = 0; m<numCandidates; m++)
+  {
+    fullMoves[m].move = candidates[m];
+    fullMoves[m].val = 0;
+  }
+
+  int numFinished = 0;
+  if(numCandidates > 0)
+    fsearch(startDepth*SearchParams::DEPTH_DIV,Eval::LOSE-1,Eval::WIN+1,numFinished,false);
+  double candidateTime = clockTimer.getSeconds();
+
+  genThread.join();
+
+  //Switch to all the moves, moving the one reaching the same position as the best candidate to the front.
+  //A search on the candidates that didn't finish leaves them unsorted, so there's no best candidate to go by.
+  hash_t bestHash = 0;
+  bool hasBest = numFinished > 0 && numFinished == numCandidates;
+  if(hasBest)
+  {
+    Board copy = b;
+    copy.makeMove(fullMoves[0].move);
+    bestHash = copy.sitCurrentHash;
+  }
+  fullMoves.swap(allMoves);
+  int numMoves = fullMoves.size();
+  for(int m = 0; hasBest && m<numMoves; m++)
+  {
+    Board copy = b;
+    copy.makeMove(fullMoves[m].move);
+    if(copy.sitCurrentHash == bestHash)
+    {
+      std::rotate(fullMoves.begin(),fullMoves.begin()+m,fullMoves.begin()+m+1);
+      break;
+    }
+  }
+
+  if(doOutput)
+  {
+    string evalString = numFinished > 0 ? ArimaaIO::writeEval(stats.finalEval) : string("-");
+    (*params.output) << Global::strprintf("Streamed root: %d/%d candidates searched in %.2f, %d moves generated by %.2f",
+        numFinished, numCandidates, candidateTime, numMoves, clockTimer.getSeconds())
+        << " Eval: " << evalString << "  PV: " << stats.pvString << endl << endl;
+  }
+
+  //Generation may have outlasted the candidate search, so check the time before starting the iterations
+  mainCheckTime();
+}
+
+void Searcher::setMultiPV(const int* hm, int numMoves)
+{
+  multiPV.clear();
+  stats.multiPVStrings.clear();
+  vector<bool> taken(numMoves,false);
+  for(int k = 0; k<params.multiPV; k++)
+  {
+    //Root moves that never beat the root alpha were left at LOSE-1 and have no exact eval
+    int idx = -1;
+    for(int i = 0; i<numMoves; i++)
+      if(!taken[i] && hm[i] > Eval::LOSE-1 && (idx < 0 || hm[i] > hm[idx]))
+        idx = i;
+    if(idx < 0)
+      break;
+    taken[idx] = true;
+
+    RootPV line;
+    line.move = fullMoves[idx].move;
+    line.eval = hm[idx];
+    line.pv = rootPVs[idx];
+    multiPV.push_back(line);
+    stats.multiPVStrings.push_back(ArimaaIO::writeEval(line.eval) + " " + Board::writeMoves(mainBoard,line.pv));
+  }
+}
+
 void Searcher::directQSearch(int depth, eval_t alpha, eval_t beta)
 {
   const Board& b = mainBoard;
@@ -634,6 +935,16 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
   bool changedPlayer = (b.step == 0);
   int numSteps = changedPlayer ? 4-oldBoardStep : b.step-oldBoardStep;
 
+  //Start loading the child's hash entry now so that it is hopefully ready by the time we get past the
+  //end conditions below. Mid-turn, we don't yet know whether we'll fall into qsearch, which hashes
+  //without the start position, so fetch both.
+  if(SearchParams::HASH_ENABLE && params.hashPrefetch)
+  {
+    mainHash->prefetch(b,false);
+    if(!changedPlayer)
+      mainHash->prefetch(b,true);
+  }
+
   //Add move to history and keep going
   curThread->boardHistory.reportMove(b,move,oldBoardStep);
 
@@ -723,7 +1034,7 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
   //END CONDITION - GOAL TREE AND ELIM TREE --------------------
   if(changedPlayer)
   {
-    int goalDist = BoardTrees::goalDist(b,pla,numStepsLeft);
+    int goalDist = SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::goalDist(b,pla,numStepsLeft));
     if(goalDist <= 4)
     {
       evalBuf = Eval::LOSE + cDepth + numStepsLeft;
@@ -731,7 +1042,7 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
       return;
     }
 
-    bool canElim = BoardTrees::canElim(b,pla,numStepsLeft);
+    bool canElim = SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::canElim(b,pla,numStepsLeft));
     if(canElim)
     {
       evalBuf = Eval::LOSE + cDepth + numStepsLeft;
@@ -812,7 +1123,8 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
     DEBUGASSERT(curThread->unsafePruneIdHash[prevTurnDepth] == curThread->boardHistory.turnSitHash[b.turnNumber-1]);
     move_t prevMove = curThread->boardHistory.turnMove[b.turnNumber-1];
 
-    bool shouldPrune = SearchPrune::matchesMove(b,gOpp(b.player),prevMove,*(curThread->unsafePruneIds[prevTurnDepth]));
+    bool shouldPrune = SEARCH_PROFILED(curThread->stats,PROFILE_PRUNE,
+        SearchPrune::matchesMove(b,gOpp(b.player),prevMove,*(curThread->unsafePruneIds[prevTurnDepth])));
     if(shouldPrune)
     {
       evalBuf = oldAlpha;
@@ -830,7 +1142,8 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
     DEBUGASSERT(b.turnNumber >= curThread->boardHistory.minTurnNumber &&
                 b.turnNumber <= curThread->boardHistory.maxTurnBoardNumber);
     move_t prevMove = curThread->boardHistory.turnMove[b.turnNumber];
-    if(SearchPrune::canHaizhiPrune(curThread->boardHistory.turnBoard[b.turnNumber],b.player,prevMove))
+    if(SEARCH_PROFILED(curThread->stats,PROFILE_PRUNE,
+        SearchPrune::canHaizhiPrune(curThread->boardHistory.turnBoard[b.turnNumber],b.player,prevMove)))
     {
       evalBuf = oldAlpha;
       b.undoMove(uData);
@@ -898,7 +1211,7 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
   {
     //Check if the opp made a goal threat
     pla_t opp = gOpp(pla);
-    int goalDist = BoardTrees::goalDist(b,opp,numStepsLeft);
+    int goalDist = SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::goalDist(b,opp,numStepsLeft));
     int extensionSteps = 0;
 
     //Check how many steps are needed to defend against the goal threat
@@ -974,7 +1287,7 @@ void Searcher::mSearch(SearchThread* curThread, SplitPoint* spt, SplitPoint*& ne
     int16_t hashDepth;
     flag_t hashFlag;
     //Found a hash?
-    if(mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,false))
+    if(SEARCH_PROFILED(curThread->stats,PROFILE_HASH,mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,false)))
     {
       //Does the entry allow for a cutoff?
       if(((hashDepth == rDepth4/4 || (SearchParams::ALLOW_UNSTABLE && hashDepth >= rDepth4/4)) &&
@@ -1114,7 +1427,7 @@ bool Searcher::mSearchDone(SearchThread* curThread, SplitPoint* spt, eval_t& eva
   {
     if(SearchParams::KILLER_ENABLE)
       SearchUtils::recordKiller(curThread->killerMoves, curThread->killerMovesLen, moveToRecord, spt->cDepth);
-    SearchUtils::updateHistoryTable(historyTable,historyMax,b,spt->cDepth,spt->bestMove);
+    history->update(curThread->id,b,spt->cDepth,spt->bestMove);
   }
 
   //Note: bestIndex can be -1 and bestMove be ERRMOVE if every move loses immediately
@@ -1227,7 +1540,8 @@ void Searcher::maybeComputePosData(Board& b, const BoardHistory& history, int rD
         curThread->unsafePruneIds.push_back(new vector<SearchPrune::ID>());
       }
       curThread->unsafePruneIdHash[turnDepth] = b.sitCurrentHash;
-      SearchPrune::findStartMatches(b,*(curThread->unsafePruneIds[turnDepth]));
+      SEARCH_PROFILED(curThread->stats,PROFILE_PRUNE,
+          SearchPrune::findStartMatches(b,*(curThread->unsafePruneIds[turnDepth])));
     }
   }
 }
@@ -1335,7 +1649,7 @@ int Searcher::qSearchQPassed(SearchThread* curThread, Board& b, int fDepth, int
     int16_t hashDepth;
     flag_t hashFlag;
     //Found a hash?
-    if(mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,true))
+    if(SEARCH_PROFILED(curThread->stats,PROFILE_HASH,mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,true)))
     {
       //Does the entry allow for a cutoff?
       if((((SearchParams::ALLOW_UNSTABLE && hashDepth >= -qDepth) || hashDepth == -qDepth)
@@ -1356,8 +1670,11 @@ int Searcher::qSearchQPassed(SearchThread* curThread, Board& b, int fDepth, int
     return beta;
   if(SearchUtils::isWinEval(alpha))
     return alpha;
-  int eval = evaluate(curThread,b,isViewing && params.viewEvaluate);
-  mainHash->record(b, cDepth, -qDepth, eval, Flags::FLAG_EXACT, ERRMOVE, true);
+  bool isLazy;
+  int eval = SEARCH_PROFILED(curThread->stats,PROFILE_EVAL,evaluate(curThread,b,alpha,beta,isViewing && params.viewEvaluate,isLazy));
+  //Lazy evals are only bounds, don't keep them
+  if(!isLazy)
+    mainHash->record(b, cDepth, -qDepth, eval, Flags::FLAG_EXACT, ERRMOVE, true);
   return eval;
 }
 
@@ -1399,11 +1716,11 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
   //And only check when the player changes, since the check for goal/elim is good for the whole turn.
   if(qState == SS_Q && b.step == 0)
   {
-    int goalDist = BoardTrees::goalDist(b,pla,numStepsLeft);
+    int goalDist = SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::goalDist(b,pla,numStepsLeft));
     if(goalDist <= 4)
       return Eval::WIN - cDepth - numStepsLeft;
 
-    if(BoardTrees::canElim(b,pla,numStepsLeft))
+    if(SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::canElim(b,pla,numStepsLeft)))
       return Eval::WIN - cDepth - numStepsLeft;
   }
 
@@ -1425,7 +1742,7 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
     int16_t hashDepth;
     flag_t hashFlag;
     //Found a hash?
-    if(mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,true))
+    if(SEARCH_PROFILED(curThread->stats,PROFILE_HASH,mainHash->lookup(hashMove,hashEval,hashDepth,hashFlag,b,cDepth,true)))
     {
       hashFound = true;
 
@@ -1470,8 +1787,11 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
     if(SearchUtils::isWinEval(alpha))
       return alpha;
 
-    int eval = evaluate(curThread,b,isViewing && params.viewEvaluate);
-    mainHash->record(b, cDepth, -qDepth, eval, Flags::FLAG_EXACT, ERRMOVE, true);
+    bool isLazy;
+    int eval = SEARCH_PROFILED(curThread->stats,PROFILE_EVAL,evaluate(curThread,b,alpha,beta,isViewing && params.viewEvaluate,isLazy));
+    //Lazy evals are only bounds, don't keep them
+    if(!isLazy)
+      mainHash->record(b, cDepth, -qDepth, eval, Flags::FLAG_EXACT, ERRMOVE, true);
     return eval;
   }
 
@@ -1517,7 +1837,7 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
       mainHash->record(b, cDepth, -qDepth, bestEval, Flags::FLAG_BETA, moveToRecord, true);
       if(SearchParams::QKILLER_ENABLE)
         SearchUtils::recordKiller(curThread->killerMoves, curThread->killerMovesLen, moveToRecord, cDepth);
-      SearchUtils::updateHistoryTable(historyTable,historyMax,b,cDepth,bestMove);
+      history->update(curThread->id,b,cDepth,bestMove);
     }
     //Perform recording of hash, killers, and history for ALPHA OR EXACT
     else
@@ -1588,7 +1908,7 @@ int Searcher::qSearch(SearchThread* curThread, Board& b, int fDepth, int cDepth,
       {
         if(SearchParams::QKILLER_ENABLE)
           SearchUtils::recordKiller(curThread->killerMoves, curThread->killerMovesLen, moveToRecord, cDepth);
-        SearchUtils::updateHistoryTable(historyTable,historyMax,b,cDepth,bestMove);
+        history->update(curThread->id,b,cDepth,bestMove);
       }
     }
   } //Done recording now
@@ -1635,7 +1955,7 @@ void Searcher::qSearchRecursion(SearchThread* curThread, Board& b, int fDepth, i
     if(killers.killer[0] == QPASSMOVE || killers.killer[1] == QPASSMOVE)
     {
       pla_t opp = gOpp(b.player);
-      if(BoardTrees::goalDist(b,opp,4) <= 4 || BoardTrees::canElim(b,opp,4))
+      if(SEARCH_PROFILED(curThread->stats,PROFILE_TREES,BoardTrees::goalDist(b,opp,4) <= 4 || BoardTrees::canElim(b,opp,4)))
       {
         if(killers.killer[0] == QPASSMOVE)
           killers.killer[0] = ERRMOVE;
@@ -1671,7 +1991,8 @@ void Searcher::qSearchRecursion(SearchThread* curThread, Board& b, int fDepth, i
   //you any faster, so you don't conclude a loss, then you generate normal moves, including qpass,
   //and then store those results in the hash, later trusting them when beta is different and
   //concluding a lost position isn't lost.
-  int num = SearchMoveGen::genShortestFullWinDefMoves(b,mv,winDefSearchInteriorNodes,winDefSteps);
+  int num = SEARCH_PROFILED(curThread->stats,PROFILE_WINDEF_MOVEGEN,
+      SearchMoveGen::genShortestFullWinDefMoves(b,mv,winDefSearchInteriorNodes,winDefSteps));
 
   //Expensive, but not counted in our node count, so add it manually.
   curThread->stats.qNodes += winDefSearchInteriorNodes;
@@ -1707,7 +2028,8 @@ void Searcher::qSearchRecursion(SearchThread* curThread, Board& b, int fDepth, i
   //or if there was no win threat.
   if(!winDefActive || (SearchParams::ALSOQ_ENABLE && b.step < 3))
   {
-    int newNum = SearchMoveGen::genQuiescenceMoves(b,curThread->boardHistory,cDepth,qDepth,mv+num,hm+num);
+    int newNum = SEARCH_PROFILED(curThread->stats,PROFILE_QSEARCH_MOVEGEN,
+        SearchMoveGen::genQuiescenceMoves(b,curThread->boardHistory,cDepth,qDepth,mv+num,hm+num));
     if(!winDefActive)
       num += newNum;
     else
@@ -1756,7 +2078,7 @@ void Searcher::qSearchRecursion(SearchThread* curThread, Board& b, int fDepth, i
 
   //Q MOVE ORDERING------------------------------
   if(SearchParams::HISTORY_ENABLE)
-    SearchUtils::getHistoryScores(historyTable,historyMax,b,b.player,cDepth,mv,hm,num);
+    history->getScores(curThread->id,b,b.player,cDepth,mv,hm,num);
 
   //Disabled - doesn't really seem to help or hurt
   //if(killerMove1 != ERRMOVE && !isSingleStepOrError(killerMove1))
@@ -1810,7 +2132,7 @@ void Searcher::qSearchRecursion(SearchThread* curThread, Board& b, int fDepth, i
         for(int i = oldNum; i<num; i++)
           hm[i] = 0;
         if(SearchParams::HISTORY_ENABLE)
-          SearchUtils::getHistoryScores(historyTable,historyMax,b,b.player,cDepth,mv+oldNum,hm+oldNum,num-oldNum);
+          history->getScores(curThread->id,b,b.player,cDepth,mv+oldNum,hm+oldNum,num-oldNum);
         moveListAq.reportUsage(num);
       }
     }
@@ -1888,6 +2210,10 @@ int Searcher::tryMove(SearchThread* curThread, move_t move, int hm, int& moveInd
     bool suc = b.makeMoveLegal(move,curThread->undoData);
     if(!suc) return TRYMOVE_ERR;
 
+    //Start loading the child's hash entry while we check repetitions and goal trees
+    if(SearchParams::HASH_ENABLE && params.hashPrefetch)
+      mainHash->prefetch(b,true);
+
     //In the qsearch, allow returning to the same position,
     //so that we can be less strict about including the turn start position in the hash
     //in case we transpose partially into the turn.
@@ -2070,7 +2396,7 @@ void Searcher::genMSearchMoves(SearchThread* curThread, SplitPoint* spt)
   case 1:
   {
     int numStepsLeft = 4-b.step;
-    num = SearchMoveGen::genWinDefMovesIfNeeded(b,mv,hm,numStepsLeft);
+    num = SEARCH_PROFILED(curThread->stats,PROFILE_WINDEF_MOVEGEN,SearchMoveGen::genWinDefMovesIfNeeded(b,mv,hm,numStepsLeft));
     if(num >= 0)
       spt->moveGenWinDefGen = true;
     else
@@ -2082,7 +2408,7 @@ void Searcher::genMSearchMoves(SearchThread* curThread, SplitPoint* spt)
     }
     if(SearchParams::HISTORY_ENABLE)
     {
-      SearchUtils::getHistoryScores(historyTable,historyMax,b,pla,cDepth,mv,hm,num);
+      history->getScores(curThread->id,b,pla,cDepth,mv,hm,num);
       for(int i = 0; i<num; i++)
         hm[i] += numStepsInMove(mv[i]);
     }
@@ -2170,7 +2496,7 @@ void Searcher::genMSearchMoves(SearchThread* curThread, SplitPoint* spt)
 
   if(SearchParams::HISTORY_ENABLE)
   {
-    SearchUtils::getHistoryScores(historyTable,historyMax,b,pla,cDepth,mv,hm,num);
+    history->getScores(curThread->id,b,pla,cDepth,mv,hm,num);
     for(int i = 0; i<num; i++)
       hm[i] += numStepsInMove(mv[i]);
   }
@@ -2319,6 +2645,22 @@ move_t Searcher::getRootMove(move_t* mv, int* hm, int numMoves, int idx)
   return mv[idx];
 }
 
+eval_t Searcher::recordRootPV(int moveIdx, move_t move, eval_t eval, eval_t alpha, const move_t* childPV, int childPVLen)
+{
+  DEBUGASSERT(moveIdx >= 0 && moveIdx < (int)rootPVs.size());
+  vector<move_t>& pv = rootPVs[moveIdx];
+  pv.assign(1,move);
+  if(childPVLen > 0)
+    pv.insert(pv.end(),childPV,childPV+childPVLen);
+
+  rootBestEvals.insert(std::upper_bound(rootBestEvals.begin(),rootBestEvals.end(),eval,std::greater<eval_t>()),eval);
+  if((int)rootBestEvals.size() > params.multiPV)
+    rootBestEvals.pop_back();
+  if((int)rootBestEvals.size() < params.multiPV)
+    return alpha;
+  return max(alpha,rootBestEvals.back());
+}
+
 move_t Searcher::getMove(move_t* mv, int* hm, int numMoves, int idx)
 {
   DEBUGASSERT(idx < numMoves);
@@ -2329,9 +2671,28 @@ move_t Searcher::getMove(move_t* mv, int* hm, int numMoves, int idx)
 //HELPERS - EVALUATION----------------------------------------------------------------------
 #include "../board/locations.h"
 
-eval_t Searcher::evaluate(SearchThread* curThread, Board& b, bool print)
+hash_t Searcher::getEvalContextHash() const
+{
+  pla_t mPla = params.overrideMainPla ? params.overrideMainPlaTo : mainPla;
+  hash_t hash = (hash_t)(mPla+1) * 0x9E3779B97F4A7C15ULL;
+
+  if(params.randomize && params.randDelta > 0)
+    hash ^= (params.randSeed + (uint64_t)params.randDelta) * 0xC2B2AE3D27D4EB4FULL;
+
+  //The early game penalties depend on the root position, so for those turns only entries
+  //from searches from the same root can be shared.
+  if((params.avoidEarlyTrade && (mainBoard.turnNumber <= SearchParams::EARLY_TRADE_TURN_MAX ||
+                                  mainBoard.turnNumber <= SearchParams::EARLY_HORSE_ATTACKED_MAX)) ||
+     (params.avoidEarlyBlockade && mainBoard.turnNumber <= SearchParams::EARLY_BLOCKADE_TURN_HALF))
+    hash ^= mainBoard.sitCurrentHash * 0x165667B19E3779F9ULL + 0x27D4EB2F165667C5ULL;
+
+  return hash;
+}
+
+eval_t Searcher::evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print, bool& isLazy)
 {
   curThread->stats.evalCalls++;
+  isLazy = false;
 
   //Override the mainpla used for special early eval and asymmetric eval
   pla_t mPla = params.overrideMainPla ? params.overrideMainPlaTo : mainPla;
@@ -2348,15 +2709,16 @@ eval_t Searcher::evaluate(SearchThread* curThread, Board& b, bool print)
       earlyBlockadePenalty /= 2;
   }
 
-  eval_t eval = Eval::evaluate(b,mPla,earlyBlockadePenalty,(print ? params.output : NULL));
-
+  //Adjustments to the eval that depend on the search rather than the position itself, computed first so that
+  //the window can be shifted by them for lazy evaluation
+  eval_t adjustment = 0;
   if(params.avoidEarlyTrade && mainBoard.turnNumber <= SearchParams::EARLY_TRADE_TURN_MAX && mPla != NPLA)
   {
     //If the mPla lost a piece, penalize the mPla for doing so
     if(b.pieceCounts[mPla][0] != mainBoard.pieceCounts[mPla][0])
     {
-      if(mPla == b.player) eval -= SearchParams::EARLY_TRADE_PENALTY;
-      else eval += SearchParams::EARLY_TRADE_PENALTY;
+      if(mPla == b.player) adjustment -= SearchParams::EARLY_TRADE_PENALTY;
+      else adjustment += SearchParams::EARLY_TRADE_PENALTY;
     }
   }
 
@@ -2365,8 +2727,8 @@ eval_t Searcher::evaluate(SearchThread* curThread, Board& b, bool print)
     if((mPla == GOLD && ((b.owners[B3] == SILV && b.pieces[B3] == HOR) || (b.owners[G3] == SILV && b.pieces[G3] == HOR))) ||
        (mPla == SILV && ((b.owners[B6] == GOLD && b.pieces[B6] == HOR) || (b.owners[G6] == GOLD && b.pieces[G6] == HOR))))
     {
-      if(mPla == b.player) eval -= SearchParams::EARLY_HORSE_ATTACKED_PENALTY;
-      else eval += SearchParams::EARLY_HORSE_ATTACKED_PENALTY;
+      if(mPla == b.player) adjustment -= SearchParams::EARLY_HORSE_ATTACKED_PENALTY;
+      else adjustment += SearchParams::EARLY_HORSE_ATTACKED_PENALTY;
     }
   }
 
@@ -2386,11 +2748,50 @@ eval_t Searcher::evaluate(SearchThread* curThread, Board& b, bool print)
 
     int randvalues = hash % d2;
     int randvalues2 = ((hash >> 32) & 0x00000000FFFFFFFFULL) % d;
-    eval += (randvalues % d)-params.randDelta;
-    eval += (randvalues/d)-params.randDelta;
-    eval += randvalues2-params.randDelta;
+    adjustment += (randvalues % d)-params.randDelta;
+    adjustment += (randvalues/d)-params.randDelta;
+    adjustment += randvalues2-params.randDelta;
   }
 
+  eval_t eval;
+  if(evalCache != NULL && !print)
+  {
+    hash_t evalHash = EvalCache::getHash(b,mPla,earlyBlockadePenalty);
+    if(evalCache->lookup(evalHash,eval))
+      curThread->stats.evalCacheHits++;
+    else
+    {
+      curThread->stats.evalCacheMisses++;
+      eval = lazyEvaluate(curThread,b,mPla,earlyBlockadePenalty,alpha-adjustment,beta-adjustment,isLazy);
+      //Lazy evals are only bounds for this window
+      if(!isLazy)
+        evalCache->record(evalHash,eval);
+    }
+  }
+  else if(print)
+    eval = Eval::evaluate(b,mPla,earlyBlockadePenalty,params.output);
+  else
+    eval = lazyEvaluate(curThread,b,mPla,earlyBlockadePenalty,alpha-adjustment,beta-adjustment,isLazy);
+
+  return eval + adjustment;
+}
+
+eval_t Searcher::lazyEvaluate(SearchThread* curThread, Board& b, pla_t mPla, eval_t earlyBlockadePenalty,
+    eval_t alpha, eval_t beta, bool& isLazy)
+{
+  const Eval::LazyMargins* lazy = params.lazyEvalPercent > 0 ? &params.lazyEvalMargins : NULL;
+  eval_t eval = Eval::evaluate(b,mPla,earlyBlockadePenalty,alpha,beta,lazy,isLazy,NULL);
+  if(isLazy)
+  {
+    curThread->stats.lazyEvals++;
+    //Check whether the full eval would have landed on the same side of the window
+    if(params.lazyEvalCheck)
+    {
+      eval_t fullEval = Eval::evaluate(b,mPla,earlyBlockadePenalty,NULL);
+      if(eval <= alpha ? fullEval > alpha : fullEval < beta)
+        curThread->stats.lazyEvalErrors++;
+    }
+  }
   return eval;
 }
 
@@ -69,6 +69,7 @@
 
 #include "../core/global.h"
 #include "../core/timer.h"
+#include "../core/largealloc.h"
 #include "../board/board.h"
 #include "../board/boardhistory.h"
 #include "../search/timecontrol.h"
@@ -79,13 +80,24 @@
 class QState;
 class SearchHashTable;
 class ExistsHashTable;
+class EvalCache;
 
 struct SplitPoint;
 struct SearchThread;
 class SearchTree;
 class SimpleLock;
+class LazySMPPool;
+class HistoryTable;
 struct RatedMove;
 
+//A root move together with its exact eval and principal variation, for multi-pv search
+struct RootPV
+{
+  move_t move;
+  eval_t eval;
+  vector<move_t> pv;
+};
+
 class Searcher
 {
   public:
@@ -125,23 +137,29 @@ class Searcher
   //Buffer for generating full moves, unchanging per iteration of search,
   //holds the root moves in their proper search order.
   vector<RatedMove> fullMoves;
-  ExistsHashTable* fullMoveHash;
+  vector<ExistsHashTable*> fullMoveHashes; //One per root movegen thread, together about the size of params.fullMoveHashExp
 
   //IDPV REPORTING---------------------------------------------------------------
   move_t* idpv;  //Holds pv found during an interative deepening
   int idpvLen;   //Length of idpv
 
+  //MULTI-PV---------------------------------------------------------------------
+  //Only used if params.multiPV > 1. The first two are mutated during an iteration only under the root splitpoint's lock.
+  vector<vector<move_t>> rootPVs; //Pv of each root move that beat the root alpha this iteration, indexed like fullMoves
+  vector<eval_t> rootBestEvals;   //Best params.multiPV exact evals found at the root this iteration, descending
+  vector<RootPV> multiPV;         //Best params.multiPV root moves as of the last completed iteration, best first
+
   //THREAD-MUTABLE SHARED=====================================================================
   //These parameters are mutated freely without any synchronization and by any thread
   //in the middle of the search.
 
   //HASHTABLE-------------------------------------------------------------------
   SearchHashTable* mainHash;
+  EvalCache* evalCache; //NULL if disabled
 
   //MOVE ORDERING AND PRUNING--------------------------------------------------
   //History Heuristic
-  vector<int64_t*> historyTable;  //[cDepth][historyIndex of move]
-  vector<int64_t> historyMax;     //[cDepth]
+  HistoryTable* history;
 
   //TIME CONTROL AND INTERRUPTION==================================================================
   //Mutex for checking or setting the ids from an external thread, or checking whether timeout
@@ -174,9 +192,15 @@ class Searcher
 
   //SEARCH TREE===================================================================================
   public:
-  //Created and destroyed for every top-level search
+  //Created on the first top-level search and reused by later ones, unless a search needs a bigger or different one
   SearchTree* searchTree;
 
+  //LAZY SMP======================================================================================
+  private:
+  LazySMPPool* lazyPool; //Helper searches run alongside this one if params.lazySMP, created when first needed
+  Searcher* lazyMaster;  //If this searcher is a lazy SMP helper, the searcher whose hashtables it shares, else NULL
+  int lazyDepthOffset;   //If this searcher is a lazy SMP helper, how many depths deeper to start iterative deepening
+
   //METHODS=================================================================================
 
   //CONSTRUCTION----------------------------------------------------------------
@@ -204,6 +228,10 @@ class Searcher
   //Get all the root moves of the search as they were sorted at the end of the search
   void getSortedRootMoves(vector<move_t>& buf);
 
+  //Get the best params.multiPV root moves with their exact evals and pvs, best first, as of the last completed
+  //iteration. May be fewer if there were fewer root moves or only losing ones, empty if params.multiPV <= 1.
+  vector<RootPV> getMultiPV();
+
   //Get the number of root moves generated (note that winlosspruning may make this smaller than
   //the true number of legal moves)
   int getNumRootMoves();
@@ -218,6 +246,15 @@ class Searcher
   //Can NOT call when there is any ongoing search, NOT threadsafe. Resizes the hashtables
   //if necessary if the [params] field has been set or edited since the searcher's creation
   void resizeHashIfNeeded();
+  //Can NOT call when there is any ongoing search, NOT threadsafe. Make this searcher a lazy SMP helper of master,
+  //using master's hashtables in place of its own, and starting iterative deepening depthOffset deeper than usual.
+  //Call again whenever master's hashtables may have been resized.
+  void becomeLazyHelper(Searcher* master, int depthOffset);
+
+  //Can NOT call when there is any ongoing search, NOT threadsafe. Save the main hashtable to a file, or replace
+  //it with one loaded from a file saved this way. Loading sets params.mainHashExp to the size of the loaded table.
+  void saveHash(const string& file);
+  void loadHash(const string& file);
 
   //Perform a search, using the default max depth, time, also obeying the above time control
   void searchID(const Board& b, const BoardHistory& hist, bool output = false);
@@ -239,6 +276,25 @@ class Searcher
   //And at the end, sorts the moves
   void fsearch(int rDepth4, eval_t alpha, eval_t beta, int& numFinished, bool briefLastDepth);
 
+  //Make sure there is a fullmove hashtable for each of numMoveGenThreads threads generating root moves
+  void prepareFullMoveHashes(int numMoveGenThreads);
+
+  //Generate the root moves into mvVec, excluding and shuffling them as the params say, using up to numThreads threads
+  void genRootMoves(const Board& b, int startDepth, vector<move_t>& mvVec, int numThreads);
+  //Fill moves with the root moves in mvVec, sorted by the root move features if enabled for this depth,
+  //using up to numThreads threads
+  void orderRootMoves(const Board& b, int maxDepth, const vector<move_t>& mvVec, vector<RatedMove>& moves,
+      int numThreads);
+  //Both of the above, single-threaded, run in the background by searchStreamedRootMoves
+  void genAndOrderRootMoves(const Board* b, int startDepth, int maxDepth, vector<RatedMove>* moves);
+  //Search a few cheap root moves at the shallowest depth for an early pv while all the root moves are generated
+  //and ordered in the background, then switch fullMoves over to them with the best candidate first
+  void searchStreamedRootMoves(const Board& b, int startDepth, int maxDepth);
+
+  //After a completed iteration of multi-pv search, take the best params.multiPV root moves from the
+  //evals the root recorded in hm, and fill in multiPV and stats.multiPVStrings.
+  void setMultiPV(const int* hm, int numMoves);
+
   //Perform qsearch directly from the top level, without going through msearch first
   void directQSearch(int depth, eval_t alpha, eval_t beta);
 
@@ -274,8 +330,15 @@ class Searcher
   //Specalization of qSearch for the leaf ply
   int qSearchQPassed(SearchThread* curThread, Board& b, int fDepth, int cDepth, int qDepth, eval_t alpha, eval_t beta);
 
-  //Evaluate the actual board position
-  eval_t evaluate(SearchThread* curThread, Board& b, bool print);
+  //Hash of everything outside of the board itself that affects evaluate during this search
+  hash_t getEvalContextHash() const;
+
+  //Evaluate the actual board position. With params.lazyEvalPercent, may return only a bound outside of (alpha,beta),
+  //setting isLazy.
+  eval_t evaluate(SearchThread* curThread, Board& b, eval_t alpha, eval_t beta, bool print, bool& isLazy);
+  //Call the lazy Eval::evaluate and count how often it was lazy, and if params.lazyEvalCheck, how often wrongly
+  eval_t lazyEvaluate(SearchThread* curThread, Board& b, pla_t mPla, eval_t earlyBlockadePenalty,
+      eval_t alpha, eval_t beta, bool& isLazy);
 
   //Compute posdata for tree features from the given board if the depth is appropriate and store in curThread
   void maybeComputePosData(Board& b, const BoardHistory& history, int rDepth4, SearchThread* curThread);
@@ -304,6 +367,11 @@ class Searcher
 
   move_t getRootMove(move_t* mv, int* hm, int numMoves, int idx);
 
+  //Record the exact eval and pv of a root move that beat the root's current alpha, for multi-pv search.
+  //Call only under the root splitpoint's lock. Returns the new alpha for the root, the worst of the best
+  //params.multiPV exact evals so far, or the given alpha if there are not yet that many.
+  eval_t recordRootPV(int moveIdx, move_t move, eval_t eval, eval_t alpha, const move_t* childPV, int childPVLen);
+
   move_t getMove(move_t* mv, int* hm, int numMoves, int idx);
 
   //Time-----------------------------------------------------------------------------
@@ -349,35 +417,94 @@ struct KillerEntry
 struct SearchHashEntry
 {
   //Note: for this to work, hash_t should be 64 bits!
+  //The low GEN_BITS of (key ^ data) hold the generation the entry was written in, and the remaining
+  //high bits verify the hash. The low bits of the hash are implied by the bucket the entry is in.
   volatile uint64_t key;
   volatile uint64_t data;
 
+  static const int GEN_BITS = 8;
+  static const uint64_t GEN_MASK = (1ULL << GEN_BITS) - 1;
+
   SearchHashEntry();
 
-  void record(hash_t hash, int16_t depth, eval_t eval, flag_t flag, move_t move);
+  void record(hash_t hash, uint8_t gen, int16_t depth, eval_t eval, flag_t flag, move_t move);
   bool lookup(hash_t hash, int16_t& depth, eval_t& eval, flag_t& flag, move_t& move);
+
+  //Unsynchronized peeks used for choosing which entry in a bucket to replace. May be torn if another
+  //thread is writing, which is fine since they only affect the replacement choice.
+  bool matches(hash_t hash) const;
+  void getReplaceInfo(uint8_t& gen, int16_t& depth, flag_t& flag) const;
+
+  //Move the generation of the entry back by shift, but not below zero. NOT threadsafe.
+  void shiftGenerationBack(uint8_t shift);
+};
+
+//A cache-line-sized group of entries. A position can be stored in any entry of the bucket it hashes to.
+struct SearchHashBucket
+{
+  static const int NUM_ENTRIES = 4;
+  SearchHashEntry entries[NUM_ENTRIES];
 };
+static_assert(sizeof(SearchHashBucket) == CACHE_LINE_BUFFER_SIZE, "SearchHashBucket must fill exactly one cache line");
 
 //Thread safe, uses lockless xor scheme to ensure data integrity
+//Entries persist across searches. Each search starts a new generation, so that entries from earlier searches
+//remain usable but are preferred for replacement, and mixes a context hash into every lookup, so that entries
+//made under a different eval context (mainPla, randomization, early game penalties) are never returned.
 class SearchHashTable
 {
   public:
-  int exponent;
-  hash_t size;
-  hash_t mask;
-  hash_t clearOffset;
-  SearchHashEntry* entries;
+  //Penalty in replacement value per generation that an entry is old
+  static const int REPLACE_AGE_WEIGHT = 8;
+
+  //Saved files consist of a header padded to this many bytes followed by the raw buckets, so that
+  //the bucket array in the file is page-aligned and the file can be memory-mapped directly.
+  static const int FILE_HEADER_BYTES = 4096;
+  static const uint64_t FILE_MAGIC = 0x3130485341485053ULL; //"SPHASH01"
 
-  SearchHashTable(int exponent); //Size will be (2 ** sizeExp)
+  int exponent;
+  hash_t size;        //Total number of entries
+  hash_t numBuckets;
+  hash_t bucketMask;
+  uint8_t generation; //Advanced on every search, entries from older generations are preferred for replacement
+  hash_t contextHash; //Mixed into all hashes, set at the start of every search
+  uint64_t numNonPersistentSearches; //Salt for the context of searches that should not see earlier entries
+  SearchHashBucket* buckets;
+
+  //Allocation info, for reporting
+  LargeAlloc::PageType pageType; //What kind of pages back the table
+  double allocSeconds;           //Time taken to allocate and initially clear the table
+  bool allocReported;            //Set once the above has been reported in a search log
+
+  //Allocation and clearing are split over numThreads threads
+  SearchHashTable(int exponent, int numThreads); //Size will be (2 ** sizeExp) entries
   ~SearchHashTable();
 
   static int getExp(uint64_t maxMem);
 
-  void clear();
+  //Erase all entries
+  void clear(int numThreads);
+
+  //Begin a new search whose evals are determined by the given context. If persist is false,
+  //entries from all earlier searches are made unreachable (without the cost of clearing them).
+  void newSearch(hash_t context, bool persist);
 
   void record(const Board& b, int cDepth, int16_t depth, eval_t eval, flag_t flag, move_t move, bool isQSearchOrEval);
   bool lookup(move_t& hashMove, eval_t& hashEval, int16_t& hashDepth, flag_t& hashFlag, const Board& b, int cDepth, bool isQSearchOrEval);
 
+  //Hint to the cpu to start loading the bucket that a lookup for this board would use
+  void prefetch(const Board& b, bool isQSearchOrEval);
+
+  //Write the table to a file, or read a table saved by save from a file, with the table's size taken from the file.
+  //The file is in native byte order.
+  void save(const string& file) const;
+  static SearchHashTable* load(const string& file, int numThreads);
+
+  private:
+  hash_t getLookupHash(const Board& b, bool isQSearchOrEval) const;
+  void clearRange(hash_t start, hash_t end);
+  void shiftGenerationsBack();
+  void recordHash(hash_t hash, int16_t depth, eval_t eval, flag_t flag, move_t move);
 };
 
 //NOT THREADSAFE!!!
@@ -400,6 +527,33 @@ class ExistsHashTable
 
 };
 
+//Thread safe, uses lockless xor scheme to ensure data integrity
+//Caches the raw result of Eval::evaluate, independently of the main hashtable so that
+//evals are not evicted by search entries. Entries remain valid across searches.
+class EvalCache
+{
+  public:
+  struct Entry
+  {
+    volatile uint64_t key;
+    volatile uint64_t data;
+  };
+
+  int exponent;
+  hash_t size;
+  hash_t mask;
+  Entry* entries;
+
+  EvalCache(int exponent); //Size will be (2 ** sizeExp)
+  ~EvalCache();
+
+  //Hash identifying the result of Eval::evaluate on the given board with the given extra eval parameters
+  static hash_t getHash(const Board& b, pla_t mainPla, eval_t earlyBlockadePenalty);
+
+  bool lookup(hash_t hash, eval_t& eval);
+  void record(hash_t hash, eval_t eval);
+};
+
 struct RatedMove
 {
   move_t move;
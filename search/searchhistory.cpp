@@ -0,0 +1,266 @@
+/*
+ * searchhistory.cpp
+ * Author: davidwu
+ */
+
+#include <cstdlib>
+#include "../core/global.h"
+#include "../core/boostthread.h"
+#include "../board/board.h"
+#include "../search/searchparams.h"
+#include "../search/searchhistory.h"
+
+using namespace std;
+
+//HELPERS---------------------------------------------------------------------------
+
+//TODO make this distinguish pushpulls from consecutive nearby steps more perfectly
+static int getHistoryIndex(move_t move)
+{
+  step_t step0 = getStep(move,0);
+  step_t step1 = getStep(move,1);
+  if(step1 == ERRSTEP || step1 == PASSSTEP || step1 == QPASSSTEP)
+    return (int)step0;
+
+  if(gDest(step1) != gSrc(step0) || gDest(step0) == gSrc(step1))
+    return (int)step0;
+  return (int)step0 + (int)gDir(step1)*256+256;
+}
+
+static int getHistoryDepth(int cDepth)
+{
+  return cDepth;
+}
+
+//ALLOCATION------------------------------------------------------------------------
+
+HistoryTable::HistoryTable()
+:mode(SearchParams::HISTORY_MODE_SHARED),numThreads(0),numDepths(0),
+ shared(NULL),sharedMax(NULL),threadTables(NULL)
+{}
+
+HistoryTable::~HistoryTable()
+{
+  freeAll();
+}
+
+void HistoryTable::freeAll()
+{
+  delete[] shared;
+  delete[] sharedMax;
+  if(threadTables != NULL)
+  {
+    for(int i = 0; i<numThreads; i++)
+    {
+      free(threadTables[i].table);
+      free(threadTables[i].max);
+    }
+    delete[] threadTables;
+  }
+  shared = NULL;
+  sharedMax = NULL;
+  threadTables = NULL;
+  numThreads = 0;
+  numDepths = 0;
+}
+
+void HistoryTable::init(int newMode, int newNumThreads, int depth)
+{
+  int newNumDepths = max(numDepths, depth + SearchParams::QMAX_CDEPTH);
+  if(shared != NULL && newMode == mode && newNumThreads == numThreads && newNumDepths == numDepths)
+    return;
+
+  freeAll();
+  mode = newMode;
+  numThreads = newNumThreads;
+  numDepths = newNumDepths;
+
+  shared = new std::atomic<int64_t>[numDepths * SearchParams::HISTORY_LEN];
+  sharedMax = new std::atomic<int64_t>[numDepths];
+  if(mode == SearchParams::HISTORY_MODE_PER_THREAD)
+  {
+    //Zeroed lazily by the OS, so rows for depths that a thread never reaches cost nothing
+    threadTables = new ThreadTable[numThreads];
+    for(int i = 0; i<numThreads; i++)
+    {
+      threadTables[i].table = (int64_t*)calloc((size_t)numDepths * SearchParams::HISTORY_LEN, sizeof(int64_t));
+      threadTables[i].max = (int64_t*)calloc(numDepths, sizeof(int64_t));
+      if(threadTables[i].table == NULL || threadTables[i].max == NULL)
+        Global::fatalError("HistoryTable: could not allocate thread tables");
+      threadTables[i].maxDIndexUsed = -1;
+    }
+  }
+  clear();
+}
+
+//MAINTENANCE-----------------------------------------------------------------------
+
+void HistoryTable::clear()
+{
+  for(int i = 0; i<numDepths; i++)
+  {
+    sharedMax[i].store(0,std::memory_order_relaxed);
+    std::atomic<int64_t>* row = shared + i * SearchParams::HISTORY_LEN;
+    for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
+      row[j].store(0,std::memory_order_relaxed);
+  }
+
+  if(threadTables != NULL)
+  {
+    for(int t = 0; t<numThreads; t++)
+    {
+      ThreadTable& tt = threadTables[t];
+      for(int i = 0; i<=tt.maxDIndexUsed; i++)
+      {
+        tt.max[i] = 0;
+        int64_t* row = tt.table + i * SearchParams::HISTORY_LEN;
+        for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
+          row[j] = 0;
+      }
+      tt.maxDIndexUsed = -1;
+    }
+  }
+}
+
+//Add every thread's private increments into the shared table and zero them
+void HistoryTable::mergeThreadTables()
+{
+  if(threadTables == NULL)
+    return;
+
+  for(int t = 0; t<numThreads; t++)
+  {
+    ThreadTable& tt = threadTables[t];
+    for(int i = 0; i<=tt.maxDIndexUsed; i++)
+    {
+      int64_t rowMax = max(sharedMax[i].load(std::memory_order_relaxed), tt.max[i]);
+      std::atomic<int64_t>* sharedRow = shared + i * SearchParams::HISTORY_LEN;
+      int64_t* row = tt.table + i * SearchParams::HISTORY_LEN;
+      for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
+      {
+        if(row[j] == 0)
+          continue;
+        int64_t val = sharedRow[j].load(std::memory_order_relaxed) + row[j];
+        sharedRow[j].store(val,std::memory_order_relaxed);
+        row[j] = 0;
+        if(val > rowMax)
+          rowMax = val;
+      }
+      sharedMax[i].store(rowMax,std::memory_order_relaxed);
+      tt.max[i] = 0;
+    }
+    tt.maxDIndexUsed = -1;
+  }
+}
+
+void HistoryTable::decay()
+{
+  mergeThreadTables();
+  for(int i = 0; i<numDepths; i++)
+  {
+    sharedMax[i].store((sharedMax[i].load(std::memory_order_relaxed)+1)/6,std::memory_order_relaxed);
+    std::atomic<int64_t>* row = shared + i * SearchParams::HISTORY_LEN;
+    for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
+      row[j].store((row[j].load(std::memory_order_relaxed)+1)/6,std::memory_order_relaxed);
+  }
+}
+
+//UPDATE AND LOOKUP-----------------------------------------------------------------
+
+//TODO is it better if msearch, qdepth 0, and qdepth -1 don't share each other's history tables?
+void HistoryTable::update(int threadId, const Board& b, int cDepth, move_t move)
+{
+  (void)b;
+  if(move == ERRMOVE)
+    return;
+
+  int dIndex = getHistoryDepth(cDepth);
+  if(dIndex >= numDepths)
+    return;
+
+  int hIndex = getHistoryIndex(move);
+  int64_t inc = hIndex >= 256 ? 2 : 1;
+  std::atomic<int64_t>& entry = shared[dIndex * SearchParams::HISTORY_LEN + hIndex];
+  std::atomic<int64_t>& entryMax = sharedMax[dIndex];
+
+  if(mode == SearchParams::HISTORY_MODE_PER_THREAD)
+  {
+    DEBUGASSERT(threadId >= 0 && threadId < numThreads);
+    ThreadTable& tt = threadTables[threadId];
+    int64_t own = (tt.table[dIndex * SearchParams::HISTORY_LEN + hIndex] += inc);
+    int64_t val = entry.load(std::memory_order_relaxed) + own;
+    if(val > tt.max[dIndex])
+      tt.max[dIndex] = val;
+    if(dIndex > tt.maxDIndexUsed)
+      tt.maxDIndexUsed = dIndex;
+  }
+  else if(mode == SearchParams::HISTORY_MODE_ATOMIC)
+  {
+    int64_t val = entry.fetch_add(inc,std::memory_order_relaxed) + inc;
+    int64_t oldMax = entryMax.load(std::memory_order_relaxed);
+    while(val > oldMax && !entryMax.compare_exchange_weak(oldMax,val,std::memory_order_relaxed))
+    {}
+  }
+  else
+  {
+    //Racy read-modify-write, increments from other threads may occasionally be lost
+    int64_t val = entry.load(std::memory_order_relaxed) + inc;
+    entry.store(val,std::memory_order_relaxed);
+    if(val > entryMax.load(std::memory_order_relaxed))
+      entryMax.store(val,std::memory_order_relaxed);
+  }
+}
+
+int64_t HistoryTable::getMax(int threadId, int dIndex) const
+{
+  int64_t histMax = sharedMax[dIndex].load(std::memory_order_relaxed);
+  if(threadTables != NULL && threadTables[threadId].max[dIndex] > histMax)
+    histMax = threadTables[threadId].max[dIndex];
+  return histMax;
+}
+
+int64_t HistoryTable::getValue(int threadId, int dIndex, int hIndex) const
+{
+  int idx = dIndex * SearchParams::HISTORY_LEN + hIndex;
+  int64_t score = shared[idx].load(std::memory_order_relaxed);
+  if(threadTables != NULL)
+    score += threadTables[threadId].table[idx];
+  return score;
+}
+
+void HistoryTable::getScores(int threadId, const Board& b, pla_t pla, int cDepth, const move_t* mv, int* hm, int len) const
+{
+  (void)b;
+  (void)pla;
+  int dIndex = getHistoryDepth(cDepth);
+  DEBUGASSERT(dIndex < numDepths);
+
+  int64_t histMax = getMax(threadId,dIndex);
+  if(histMax == 0)
+    return;
+
+  for(int m = 0; m < len; m++)
+  {
+    int64_t score = getValue(threadId,dIndex,getHistoryIndex(mv[m]));
+    if(score > histMax)
+      score = histMax;
+    hm[m] += (int)(score*SearchParams::HISTORY_SCORE_MAX/histMax);
+  }
+}
+
+int HistoryTable::getScore(int threadId, const Board& b, pla_t pla, int cDepth, move_t move) const
+{
+  (void)b;
+  (void)pla;
+  int dIndex = getHistoryDepth(cDepth);
+  DEBUGASSERT(dIndex < numDepths);
+
+  int64_t histMax = getMax(threadId,dIndex);
+  if(histMax == 0)
+    return 0;
+
+  int64_t score = getValue(threadId,dIndex,getHistoryIndex(move));
+  if(score > histMax)
+    score = histMax;
+  return (int)(score*SearchParams::HISTORY_SCORE_MAX/histMax);
+}
@@ -0,0 +1,75 @@
+/*
+ * searchhistory.h
+ * Author: davidwu
+ *
+ * The history heuristic for move ordering, indexed by cDepth and by a rough classification of the move.
+ *
+ * With many threads, having them all increment one table means every update to a popular entry bounces its
+ * cache line between cores. So by default (HISTORY_MODE_PER_THREAD), each thread increments only a private
+ * table of its own, and reads the sum of its private table and a shared table. Between iterations, when
+ * the history is decayed anyway, the master merges all private tables into the shared one.
+ * With a single thread this orders moves exactly as one table would.
+ *
+ * HISTORY_MODE_SHARED (one table, racy updates) and HISTORY_MODE_ATOMIC (one table, relaxed atomic updates)
+ * remain available for comparison.
+ */
+
+#ifndef SEARCHHISTORY_H_
+#define SEARCHHISTORY_H_
+
+#include "../core/global.h"
+#include "../core/boostthread.h"
+#include "../board/board.h"
+
+class HistoryTable
+{
+  struct ThreadTable
+  {
+    int64_t* table;      //[dIndex * HISTORY_LEN + hIndex], private increments not yet merged
+    int64_t* max;        //[dIndex], max of shared plus private value seen by this thread's updates
+    int maxDIndexUsed;   //Highest dIndex with any nonzero private entries, -1 if none
+    char padding[CACHE_LINE_BUFFER_SIZE];
+  };
+
+  int mode;
+  int numThreads;
+  int numDepths;
+
+  std::atomic<int64_t>* shared;    //[dIndex * HISTORY_LEN + hIndex]
+  std::atomic<int64_t>* sharedMax; //[dIndex]
+  ThreadTable* threadTables;       //[threadId], only for HISTORY_MODE_PER_THREAD
+
+  public:
+  HistoryTable();
+  ~HistoryTable();
+
+  //Ensure the table is set up for the given mode and number of threads, and for searches up to the given
+  //depth. Clears the history if anything had to be reallocated.
+  //Not threadsafe, call only before search!
+  void init(int mode, int numThreads, int depth);
+
+  //Call whenever we want to clear the history table
+  //Not threadsafe, call only when no threads are searching
+  void clear();
+
+  //Merge any private tables and cut all history scores down, call between iterations of iterative deepening
+  //Not threadsafe, call only when no threads are searching
+  void decay();
+
+  //Update the history table for a good move found by the given thread
+  void update(int threadId, const Board& b, int cDepth, move_t move);
+
+  //Fill history scores into the hm array for all moves, as seen by the given thread
+  void getScores(int threadId, const Board& b, pla_t pla, int cDepth, const move_t* mv, int* hm, int len) const;
+
+  //Get the history score for a single move, as seen by the given thread
+  int getScore(int threadId, const Board& b, pla_t pla, int cDepth, move_t move) const;
+
+  private:
+  void freeAll();
+  void mergeThreadTables();
+  int64_t getMax(int threadId, int dIndex) const;
+  int64_t getValue(int threadId, int dIndex, int hIndex) const;
+};
+
+#endif /* SEARCHHISTORY_H_ */
@@ -4,7 +4,9 @@
  */
 
 #include <set>
+#include <algorithm>
 #include "../core/global.h"
+#include "../core/boostthread.h"
 #include "../board/board.h"
 #include "../board/boardhistory.h"
 #include "../board/boardmovegen.h"
@@ -17,11 +19,23 @@
 
 //FULL MOVE GENERATION (ROOT) -------------------------------------------------------------------
 
+//One thread's share of a root move generation split among several threads
+struct FullMoveSplit
+{
+  int numThreads;          //Number of threads splitting the generation
+  int threadIdx;           //This thread expands the first steps whose index is threadIdx mod numThreads
+  int firstIdx;            //Index among the first steps of the first step of the moves currently being generated
+  vector<move_t> moves;    //Moves generated by this thread
+  vector<hash_t> hashes;   //Situation hash after each move
+  vector<int> firstIdxs;   //Index of the first step of each move
+};
+
 static void genFullMoveHelper(Board& b, const BoardHistory& hist,
     pla_t pla, vector<move_t>& moves, move_t moveSoFar,
     int nsSoFar, int maxSteps, hash_t prevHashes[5], int numPrevHashes,
     bool winLossPrune, bool restrictToRelTactics, int rootMaxNonRelTactics,
-    ExistsHashTable* fullMoveHash, const set<hash_t>& excludedHashSet, const vector<move_t>* excludedStepSets)
+    ExistsHashTable* fullMoveHash, const set<hash_t>& excludedHashSet, const vector<move_t>* excludedStepSets,
+    FullMoveSplit* split)
 {
   //Terminate if you've generated for as many steps as you're allowed, or the turn has switched.
   if(maxSteps <= 0 || b.player != pla)
@@ -76,6 +90,11 @@ static void genFullMoveHelper(Board& b, const BoardHistory& hist,
 
     //Keep going!
     moves.push_back(moveSoFar);
+    if(split != NULL)
+    {
+      split->hashes.push_back(b.sitCurrentHash);
+      split->firstIdxs.push_back(split->firstIdx);
+    }
     return;
   }
   move_t mv[1024];
@@ -122,6 +141,14 @@ static void genFullMoveHelper(Board& b, const BoardHistory& hist,
   UndoMoveData uData;
   for(int i = 0; i<num; i++)
   {
+    //If splitting among threads, only expand our own share of the first steps
+    if(split != NULL && numPrevHashes == 1)
+    {
+      if(i % split->numThreads != split->threadIdx)
+        continue;
+      split->firstIdx = i;
+    }
+
     move_t move = mv[i];
     b.makeMove(move,uData);
 
@@ -150,15 +177,107 @@ static void genFullMoveHelper(Board& b, const BoardHistory& hist,
     move_t newMoveSoFar = concatMoves(moveSoFar,mv[i],nsSoFar);
     int newRootMaxNonRelTactics = i >= numRelTactics ? rootMaxNonRelTactics-1 : rootMaxNonRelTactics;
     genFullMoveHelper(b,hist,pla,moves,newMoveSoFar,nsSoFar+ns,maxSteps-ns,
-        prevHashes,numPrevHashes+1,winLossPrune,restrictToRelTactics,newRootMaxNonRelTactics,fullMoveHash,excludedHashSet,excludedStepSets);
+        prevHashes,numPrevHashes+1,winLossPrune,restrictToRelTactics,newRootMaxNonRelTactics,fullMoveHash,excludedHashSet,excludedStepSets,split);
     b.undoMove(uData);
   }
 }
 
+static void genFullMovesSplit(const Board* board, const BoardHistory* hist, int maxSteps,
+    bool winLossPrune, int rootMaxNonRelTactics,
+    ExistsHashTable* fullMoveHash, const set<hash_t>* excludedHashSet, const vector<move_t>* excludedStepSets,
+    FullMoveSplit* split)
+{
+  Board b = *board;
+  hash_t prevHashes[5];
+  prevHashes[0] = (b.step == 0 ? b.posCurrentHash : b.posStartHash);
+  int numPrevHashes = 1;
+  fullMoveHash->clear();
+  genFullMoveHelper(b, *hist, b.player, split->moves, ERRMOVE, 0, maxSteps,
+      prevHashes, numPrevHashes, winLossPrune, rootMaxNonRelTactics < 4, rootMaxNonRelTactics, fullMoveHash,
+      *excludedHashSet, excludedStepSets, split);
+}
+
+//Generate the full moves with the first steps split round-robin among threads, then merge their results.
+//Each thread only knows about transpositions within its own share, and its hashtable may miss some when overloaded,
+//so the same resulting position may have been generated more than once - keep only the one that the serial
+//generation order would have reached first.
+static void genFullMovesOnce(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
+    bool winLossPrune, int rootMaxNonRelTactics, ExistsHashTable* const* fullMoveHashes, int numThreads,
+    const set<hash_t>& excludedHashSet, const vector<move_t>* excludedStepSets)
+{
+  vector<FullMoveSplit> splits(numThreads);
+  for(int i = 0; i<numThreads; i++)
+  {
+    splits[i].numThreads = numThreads;
+    splits[i].threadIdx = i;
+    splits[i].firstIdx = -1;
+  }
+  if(numThreads <= 1)
+    genFullMovesSplit(&b,&hist,maxSteps,winLossPrune,rootMaxNonRelTactics,
+        fullMoveHashes[0],&excludedHashSet,excludedStepSets,&splits[0]);
+  else
+  {
+    vector<std::thread> threads;
+    for(int i = 0; i<numThreads; i++)
+      threads.push_back(std::thread(&genFullMovesSplit,&b,&hist,maxSteps,winLossPrune,rootMaxNonRelTactics,
+          fullMoveHashes[i],&excludedHashSet,excludedStepSets,&splits[i]));
+    for(int i = 0; i<numThreads; i++)
+      threads[i].join();
+  }
+
+  //Interleave the threads' results back into serial order. Each thread's moves are grouped by first step in
+  //increasing order, and first step i belongs to thread i mod numThreads.
+  int maxFirstIdx = -1;
+  for(int i = 0; i<numThreads; i++)
+    if(splits[i].firstIdxs.size() > 0)
+      maxFirstIdx = max(maxFirstIdx,splits[i].firstIdxs.back());
+
+  vector<move_t> ordered;
+  vector<hash_t> orderedHashes;
+  vector<size_t> pos(numThreads,0);
+  for(int firstIdx = 0; firstIdx <= maxFirstIdx; firstIdx++)
+  {
+    FullMoveSplit& split = splits[firstIdx % numThreads];
+    size_t& p = pos[firstIdx % numThreads];
+    while(p < split.moves.size() && split.firstIdxs[p] == firstIdx)
+    {
+      ordered.push_back(split.moves[p]);
+      orderedHashes.push_back(split.hashes[p]);
+      p++;
+    }
+  }
+  DEBUGASSERT(ordered.size() == orderedHashes.size());
+
+  //Sort by resulting position, so that duplicates are adjacent, and keep the earliest of each
+  size_t num = ordered.size();
+  vector<std::pair<hash_t,size_t>> byHash(num);
+  for(size_t i = 0; i<num; i++)
+    byHash[i] = std::make_pair(orderedHashes[i],i);
+  std::sort(byHash.begin(),byHash.end());
+
+  vector<bool> keep(num,false);
+  for(size_t i = 0; i<num; i++)
+    if(i == 0 || byHash[i].first != byHash[i-1].first)
+      keep[byHash[i].second] = true;
+
+  for(size_t i = 0; i<num; i++)
+    if(keep[i])
+      moves.push_back(ordered[i]);
+}
+
 void SearchMoveGen::genFullMoves(const Board& board, const BoardHistory& hist,
     vector<move_t>& moves, int maxSteps,
     bool winLossPrune, int rootMaxNonRelTactics,
     ExistsHashTable* fullMoveHash, const vector<hash_t>* excludedHashes, const vector<move_t>* excludedStepSets)
+{
+  genFullMoves(board,hist,moves,maxSteps,winLossPrune,rootMaxNonRelTactics,&fullMoveHash,1,excludedHashes,excludedStepSets);
+}
+
+void SearchMoveGen::genFullMoves(const Board& board, const BoardHistory& hist,
+    vector<move_t>& moves, int maxSteps,
+    bool winLossPrune, int rootMaxNonRelTactics,
+    ExistsHashTable* const* fullMoveHashes, int numThreads,
+    const vector<hash_t>* excludedHashes, const vector<move_t>* excludedStepSets)
 {
   Board b = board;
 
@@ -181,19 +300,55 @@ void SearchMoveGen::genFullMoves(const Board& board, const BoardHistory& hist,
       excludedHashSet.insert((*excludedHashes)[i]);
   }
 
-  hash_t prevHashes[5];
-  prevHashes[0] = (b.step == 0 ? b.posCurrentHash : b.posStartHash);
-  int numPrevHashes = 1;
-  fullMoveHash->clear();
-  genFullMoveHelper(b, hist, b.player, moves, ERRMOVE, 0, maxSteps,
-      prevHashes, numPrevHashes, winLossPrune, rootMaxNonRelTactics < 4, rootMaxNonRelTactics, fullMoveHash, excludedHashSet, excludedStepSets);
+  genFullMovesOnce(b, hist, moves, maxSteps, winLossPrune, rootMaxNonRelTactics, fullMoveHashes, numThreads,
+      excludedHashSet, excludedStepSets);
 
   //If we failed to generate any moves (presumably because they were all losses), then try again without pruning
   if(winLossPrune && moves.size() == 0)
   {
-    fullMoveHash->clear();
-    genFullMoveHelper(b, hist, b.player, moves, ERRMOVE, 0, maxSteps,
-        prevHashes, numPrevHashes, false, rootMaxNonRelTactics < 4, rootMaxNonRelTactics, fullMoveHash, excludedHashSet, excludedStepSets);
+    genFullMovesOnce(b, hist, moves, maxSteps, false, rootMaxNonRelTactics, fullMoveHashes, numThreads,
+        excludedHashSet, excludedStepSets);
+  }
+}
+
+void SearchMoveGen::genQuickFullMoves(const Board& board, const BoardHistory& hist, vector<move_t>& moves, move_t hintMove,
+    const vector<hash_t>* excludedHashes)
+{
+  Board b = board;
+  pla_t pla = b.player;
+  int numSteps = 4-b.step;
+  hash_t startHash = b.step == 0 ? b.posCurrentHash : b.posStartHash;
+
+  move_t winningMove = getFullGoalMove(b);
+  if(winningMove != ERRMOVE)
+  {moves.push_back(winningMove); return;}
+
+  move_t mv[2048];
+  int hm[2048];
+  int num = 0;
+  if(hintMove != ERRMOVE)
+    mv[num++] = hintMove;
+  num += genCaptureMoves(b,numSteps,mv+num,hm+num);
+
+  set<hash_t> seenHashes;
+  if(excludedHashes != NULL)
+    seenHashes.insert(excludedHashes->begin(),excludedHashes->end());
+  for(int i = 0; i<num; i++)
+  {
+    move_t move = mv[i];
+    int ns = numStepsInMove(move);
+    if(ns < numSteps)
+      move = concatMoves(move,PASSMOVE,ns);
+
+    Board copy = b;
+    if(!copy.makeMoveLegalNoUndo(move) || copy.player == pla || copy.posCurrentHash == startHash)
+      continue;
+    if(BoardHistory::isThirdRepetition(copy,hist))
+      continue;
+    //Skip excluded moves and transpositions of moves we already have
+    if(!seenHashes.insert(copy.sitCurrentHash).second)
+      continue;
+    moves.push_back(move);
   }
 }
 
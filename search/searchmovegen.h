@@ -14,10 +14,22 @@ class ExistsHashTable;
 namespace SearchMoveGen
 {
   //FULL MOVE GENERATION (ROOT) ---------------------------------------------------------
-  //Generate all full legal moves in the board position
+  //Generate all full legal moves in the board position, each resulting in a different position
   void genFullMoves(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
       bool winLossPrune, int rootMaxNonRelTactics,
       ExistsHashTable* fullMoveHash, const vector<hash_t>* excludedHashes, const vector<move_t>* excludedStepSets);
+  //Same, but split among numThreads threads by first step, each pruning transpositions with its own fullMoveHashes[i].
+  //Whatever transpositions get past those, such as between threads or due to an overloaded hashtable, are removed
+  //afterwards by sorting on the resulting position.
+  void genFullMoves(const Board& b, const BoardHistory& hist, vector<move_t>& moves, int maxSteps,
+      bool winLossPrune, int rootMaxNonRelTactics,
+      ExistsHashTable* const* fullMoveHashes, int numThreads,
+      const vector<hash_t>* excludedHashes, const vector<move_t>* excludedStepSets);
+  //Generate a handful of cheap full moves likely to be among the best - the goal move if any, else hintMove
+  //if it's a legal full move and then captures completed with a pass - with the same repetition and exclusion
+  //pruning as genFullMoves but no win-loss pruning. Meant for searching while genFullMoves is still running.
+  void genQuickFullMoves(const Board& b, const BoardHistory& hist, vector<move_t>& moves, move_t hintMove,
+      const vector<hash_t>* excludedHashes);
 
   //Using the goal tree, get the full goaling move in the position, if it exists
   //Does not check for immo or elim winning moves.
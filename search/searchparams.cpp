@@ -51,6 +51,8 @@ void SearchParams::init()
   randDelta = 0;
   randSeed = 0;
   numThreads = 1;
+  lazySMP = false;
+  pinThreads = false;
 
   output = &cout;
 
@@ -61,9 +63,18 @@ void SearchParams::init()
   overrideMainPla = false;
   overrideMainPlaTo = NPLA;
   allowReduce = true;
+  aspirationWindow = DEFAULT_ASPIRATION_WINDOW;
+  multiPV = 1;
+  streamRootMoves = false;
+  lazyEvalPercent = 0;
+  lazyEvalCheck = false;
 
   fullMoveHashExp = DEFAULT_FULLMOVE_HASH_EXP;
   mainHashExp = DEFAULT_MAIN_HASH_EXP;
+  evalCacheExp = DEFAULT_EVAL_CACHE_EXP;
+  hashPrefetch = true;
+  hashPersist = true;
+  historyMode = HISTORY_MODE_PER_THREAD;
 
   qEnable = true;
   extensionEnable = true;
@@ -97,11 +108,23 @@ SearchParams::~SearchParams()
 //How many parallel threads to use for the search?
 void SearchParams::setNumThreads(int num)
 {
-  if(num <= 0 || num > MAX_THREADS)
+  if(num <= 0)
     Global::fatalError("Invalid number of threads: " + Global::intToString(num));
   numThreads = num;
 }
 
+//Use lazy SMP instead of splitpoints to parallelize?
+void SearchParams::setLazySMP(bool b)
+{
+  lazySMP = b;
+}
+
+//Pin search threads to cpus?
+void SearchParams::setPinThreads(bool b)
+{
+  pinThreads = b;
+}
+
 //Output-----------------------------
 
 void SearchParams::setOutput(ostream* out)
@@ -213,6 +236,34 @@ void SearchParams::setAllowReduce(bool allow)
   allowReduce = allow;
 }
 
+void SearchParams::setAspirationWindow(int window)
+{
+  if(window < 0)
+    Global::fatalError("Invalid aspiration window: " + Global::intToString(window));
+  aspirationWindow = window;
+}
+
+void SearchParams::setMultiPV(int num)
+{
+  if(num < 1)
+    Global::fatalError("Invalid multipv: " + Global::intToString(num));
+  multiPV = num;
+}
+
+void SearchParams::setStreamRootMoves(bool b)
+{
+  streamRootMoves = b;
+}
+
+void SearchParams::setLazyEval(int percent, bool check)
+{
+  if(percent < 0)
+    Global::fatalError(string("Invalid lazy eval percent: ") + Global::intToString(percent));
+  lazyEvalPercent = percent;
+  lazyEvalMargins.setScaled(percent);
+  lazyEvalCheck = check;
+}
+
 void SearchParams::setDefaultMaxDepthTime(int depth, double time)
 {
   defaultMaxDepth = depth;
@@ -229,6 +280,23 @@ void SearchParams::setMoveImmediatelyIfOnlyOneNonlosing(bool b)
   moveImmediatelyIfOnlyOneNonlosing = b;
 }
 
+void SearchParams::setHashPrefetch(bool b)
+{
+  hashPrefetch = b;
+}
+
+void SearchParams::setHashPersist(bool b)
+{
+  hashPersist = b;
+}
+
+void SearchParams::setHistoryMode(int mode)
+{
+  if(mode != HISTORY_MODE_SHARED && mode != HISTORY_MODE_ATOMIC && mode != HISTORY_MODE_PER_THREAD)
+    Global::fatalError("Invalid history mode: " + Global::intToString(mode));
+  historyMode = mode;
+}
+
 //VIEW--------------------------------------------------------------------------------------
 
 void SearchParams::initView(const Board& b, const string& moveStr, bool printBetterMoves, bool printMoves, bool exactHash)
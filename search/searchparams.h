@@ -14,6 +14,7 @@
 #include "../learning/learner.h"
 #include "../learning/featurearimaa.h"
 #include "../eval/evalparams.h"
+#include "../eval/eval.h"
 #include "../search/searchflags.h"
 
 struct SearchStats;
@@ -27,9 +28,6 @@ struct SearchParams
   //Disabling this will probably cause a tremendous slowdown
   static const bool ALLOW_UNSTABLE = true;
 
-  //MULTITHREADING----------------------------------------------------------
-  static const int MAX_THREADS = 32; //Max number of threads allowed
-
   //ARRAY SIZES AND ALLOC-----------------------------------------------------
   //In addtion, syncWithSplitPointDistant might need work in this case (but maybe not - think about it)
   static const int PV_ARRAY_SIZE = 96; //Size of PV arrays for principal variation storage
@@ -56,6 +54,8 @@ struct SearchParams
   static const bool HASH_WL_UNSAFE = false && ALLOW_UNSTABLE; //Return hashtable proven win/losses even if not bounding alpha/beta.
   static const bool HASH_NO_USE_QBM_IN_MAIN = false; //Don't use qsearch best moves in main search
   static const int DEFAULT_FULLMOVE_HASH_EXP = 21; //Size of hashtable for finding full moves at root is 2**FULLMOVE_HASH_EXP
+  static const int MAX_ROOT_MOVEGEN_THREADS = 8; //Split root move generation among at most this many threads
+  static const int DEFAULT_EVAL_CACHE_EXP = 20; //Size of the eval cache is 2**EVAL_CACHE_EXP
 
   //For middle-of-turn hash entries, mix in some startPosHash as well to avoid conflating
   //two situations whose situation hash is identical but whose legal moves are different because
@@ -144,11 +144,21 @@ struct SearchParams
   static const int HISTORY_LEN = 256*5; //[256 pla steps, 256*4 steps+push/pull dir]
   static const int HISTORY_SCORE_MAX = 10000;
 
+  //How history tables are updated by multiple threads, see searchhistory.h
+  static const int HISTORY_MODE_SHARED = 0;     //One table updated by all threads without synchronization
+  static const int HISTORY_MODE_ATOMIC = 1;     //One table updated by all threads with relaxed atomic increments
+  static const int HISTORY_MODE_PER_THREAD = 2; //Private table per thread, merged between iterations
+
   static const int MOVEWEIGHTS_SCALE = 50; //Amount to multiply bt move weights by
 
   //PVS-------------------------------------------------------------------------
   static const bool PVS_ENABLE = true;
 
+  //ASPIRATION WINDOWS----------------------------------------------------------
+  static const int DEFAULT_ASPIRATION_WINDOW = 300; //Initial half-width of the root window around the last iteration's eval
+  static const int ASPIRATION_GROWTH = 4; //Multiply the half-width by this on each fail high or low
+  static const int ASPIRATION_MIN_DEPTH = 8; //Shallower iterations swing too much from step to step to be worth it
+
   //NULL MOVE PRUNING-----------------------------------------------------------
   static const int NULLMOVE_REDUCE_DEPTH_BORDERLINE = 1;
   static const int NULLMOVE_REDUCE_DEPTH = 1;
@@ -167,6 +177,11 @@ struct SearchParams
 
   //MULTITHREADING---------------------------------------------------------------
   int numThreads; //Default = 1, Number of threads
+  //Default = false, Instead of splitting the tree among threads, run numThreads-1 helper searches on private
+  //boards with staggered depths that share only the hashtables with the main search ("lazy SMP").
+  bool lazySMP;
+  //Default = false, Pin each search thread to its own cpu, so that it stays next to the memory it allocated
+  bool pinThreads;
 
   //OUTPUT-----------------------------------------------------------------------
   ostream* output; //Default = cout
@@ -186,10 +201,30 @@ struct SearchParams
   bool overrideMainPla; //Default = false, use normal asymmetric evaluation, such as for blockades and mobility
   pla_t overrideMainPlaTo; //If overrideMainPla is set, override mainpla to this for asymmetric evaluation (NPLA disables it)
   bool allowReduce; //Default = true, Allow reducing depth like LMR
-
-  //These two parameters need to be set BEFORE creating the searcher!!
+  int aspirationWindow; //Default = DEFAULT_ASPIRATION_WINDOW, Half-width of root aspiration windows, 0 searches every iteration with a full window
+  int multiPV; //Default = 1, Number of best root moves to find exact evals and pvs for
+  bool streamRootMoves; //Default = false, Search a few cheap root moves while the full root moves are generated and ordered
+  //Default = 0 (disabled), In qsearch leaves, stop the eval after material and trap control if that partial score is
+  //beyond the window by more than the skipped terms could move it, and return only a bound. The margins for the
+  //skipped terms are this percent of Eval::LazyMargins' defaults
+  int lazyEvalPercent;
+  Eval::LazyMargins lazyEvalMargins; //Margins scaled by lazyEvalPercent
+  bool lazyEvalCheck; //Default = false, Also compute the full eval for every lazy exit and count those on the wrong side
+
+  //These parameters need to be set BEFORE creating the searcher!!
   int fullMoveHashExp; //Size of hashtable for root move generation is 2**this, defaults to DEFAULT_FULLMOVE_HASH_EXP
   int mainHashExp; //Size of main hashtable is 2**this, defaults to DEFAULT_MAIN_HASH_EXP
+  int evalCacheExp; //Size of eval cache is 2**this, defaults to DEFAULT_EVAL_CACHE_EXP, 0 disables the cache
+
+  //Prefetch the hashtable buckets for child nodes as soon as the move is made, so that the memory
+  //access overlaps with the end condition checks and goal trees done before the lookup
+  bool hashPrefetch; //Default = true
+
+  //Keep main hashtable entries from earlier searches usable for later ones with the same eval context
+  bool hashPersist; //Default = true
+
+  //How threads share the history heuristic, one of the HISTORY_MODE constants
+  int historyMode; //Default = HISTORY_MODE_PER_THREAD
 
   //Enable qsearch?
   bool qEnable; //Default = true
@@ -256,6 +291,10 @@ struct SearchParams
 
   //How many parallel threads to use for the search?
   void setNumThreads(int num);
+  //Use lazy SMP instead of splitpoints to parallelize?
+  void setLazySMP(bool b);
+  //Pin search threads to cpus?
+  void setPinThreads(bool b);
 
   //Output------------------------------------------
 
@@ -306,6 +345,15 @@ struct SearchParams
   void setOverrideMainPla(bool override, pla_t to);
   //Set the searcher to allow LMR and similar depth reduction
   void setAllowReduce(bool allow);
+  //Set the initial half-width of root aspiration windows, 0 to disable them
+  void setAspirationWindow(int window);
+  //Set the number of best root moves to find exact evals and pvs for, instead of only the best
+  void setMultiPV(int num);
+  //Set the searcher to start searching before root move generation finishes, for a pv sooner
+  void setStreamRootMoves(bool b);
+  //Enable lazy evaluation with margins of the given percent of the defaults (0 disables), and optionally checking it
+  //against the full eval
+  void setLazyEval(int percent, bool check);
 
   //Re-set the default max depth and time, negative indicates unbounded time.
   void setDefaultMaxDepthTime(int depth, double time);
@@ -316,6 +364,15 @@ struct SearchParams
   //Try to move immediately if there's only one move that doesn't instantly lose.
   void setMoveImmediatelyIfOnlyOneNonlosing(bool b);
 
+  //Prefetch hashtable entries for child nodes?
+  void setHashPrefetch(bool b);
+
+  //Keep hashtable entries from earlier searches?
+  void setHashPersist(bool b);
+
+  //How should threads share the history heuristic?
+  void setHistoryMode(int mode);
+
   //View----------------------------------------------
 
   //Indicate a board position to examine in the next search.
@@ -0,0 +1,47 @@
+/*
+ * searchprofile.h
+ * Author: davidwu
+ *
+ * Optional profiling of the phases of the search. Compiled with SEARCH_PROFILE defined, each
+ * SEARCH_PROFILED(stats,phase,expr) adds the wall time and a call for evaluating expr to that phase in
+ * stats. Otherwise it's just expr, and costs nothing.
+ */
+
+#ifndef SEARCHPROFILE_H_
+#define SEARCHPROFILE_H_
+
+#include "../search/searchstats.h"
+
+#ifdef SEARCH_PROFILE
+
+#include <chrono>
+
+//Times its own lifetime into a phase of the stats. As a temporary in SEARCH_PROFILED, it lives until the
+//end of the full expression containing expr.
+class SearchProfileTimer
+{
+  SearchStats& stats;
+  int phase;
+  std::chrono::steady_clock::time_point start;
+
+  public:
+  inline SearchProfileTimer(SearchStats& s, int p)
+  :stats(s),phase(p),start(std::chrono::steady_clock::now())
+  {}
+  inline ~SearchProfileTimer()
+  {
+    stats.phaseCalls[phase]++;
+    stats.phaseNanos[phase] +=
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+  }
+};
+
+#define SEARCH_PROFILED(stats,phase,expr) (SearchProfileTimer((stats),SearchStats::phase), (expr))
+
+#else
+
+#define SEARCH_PROFILED(stats,phase,expr) (expr)
+
+#endif
+
+#endif /* SEARCHPROFILE_H_ */
@@ -6,11 +6,19 @@
 #include "../search/search.h"
 #include "../program/arimaaio.h"
 
+const char* const SearchStats::PROFILE_PHASE_NAMES[SearchStats::NUM_PROFILE_PHASES] = {
+  "MSearchMoveGen", "QSearchMoveGen", "WinDefMoveGen", "Eval", "Hash", "Prune", "Trees", "Sync"
+};
+
 SearchStats::SearchStats()
 {
   mNodes = 0;
   qNodes = 0;
   evalCalls = 0;
+  evalCacheHits = 0;
+  evalCacheMisses = 0;
+  lazyEvals = 0;
+  lazyEvalErrors = 0;
   mHashCuts = 0;
   qHashCuts = 0;
   betaCuts = 0;
@@ -20,8 +28,20 @@ SearchStats::SearchStats()
   publicWorkDepthSum = 0;
   threadAborts = 0;
   abortedBranches = 0;
+  syncCount = 0;
+  syncMovesReplayed = 0;
+  syncTime = 0;
+
+  aspirationFails = 0;
+
+  for(int i = 0; i<NUM_PROFILE_PHASES; i++)
+  {
+    phaseCalls[i] = 0;
+    phaseNanos[i] = 0;
+  }
 
   timeTaken = 0;
+  firstPVTime = 0;
   depthReached = 0;
   finalEval = 0;
   randSeed = 0;
@@ -36,6 +56,10 @@ ostream& operator<<(ostream& out, const SearchStats& stats)
   << " MNodes " << stats.mNodes
   << " QNodes " << stats.qNodes
   << " Evals " << stats.evalCalls
+  << " EvalCacheHits " << stats.evalCacheHits
+  << " EvalCacheMisses " << stats.evalCacheMisses
+  << " LazyEvals " << stats.lazyEvals
+  << " LazyEvalErrors " << stats.lazyEvalErrors
   << " BetaCut " << stats.betaCuts
   << " MHashCut " << stats.mHashCuts
   << " QHashCut " << stats.qHashCuts
@@ -44,9 +68,23 @@ ostream& operator<<(ostream& out, const SearchStats& stats)
   << " PubWorkAvgDepth " << (stats.publicWorkRequests == 0 ? 0 : (double)stats.publicWorkDepthSum/stats.publicWorkRequests)
   << " ThreadAborts " << stats.threadAborts
   << " AbortedBranches " << stats.abortedBranches
+  << " Syncs " << stats.syncCount
+  << " SyncReplayed " << stats.syncMovesReplayed
+  << " SyncTime " << stats.syncTime
+  << " AspFails " << stats.aspirationFails
+  << " FirstPV " << stats.firstPVTime
   << " Seed " << Global::uint64ToHexString(stats.randSeed)
-  << endl
-  << "PV: " << stats.pvString;
+  << endl;
+#ifdef SEARCH_PROFILE
+  out << "Profile:";
+  for(int i = 0; i<SearchStats::NUM_PROFILE_PHASES; i++)
+    out << Global::strprintf(" %s %lld/%.3fs", SearchStats::PROFILE_PHASE_NAMES[i],
+        (long long)stats.phaseCalls[i], stats.phaseNanos[i] / 1.0e9);
+  out << endl;
+#endif
+  out << "PV: " << stats.pvString;
+  for(int i = 0; i<(int)stats.multiPVStrings.size(); i++)
+    out << endl << "MultiPV " << (i+1) << ": " << stats.multiPVStrings[i];
 
   return out;
 }
@@ -83,6 +121,10 @@ SearchStats& SearchStats::operator+=(const SearchStats& rhs)
   mNodes += rhs.mNodes;
   qNodes += rhs.qNodes;
   evalCalls += rhs.evalCalls;
+  evalCacheHits += rhs.evalCacheHits;
+  evalCacheMisses += rhs.evalCacheMisses;
+  lazyEvals += rhs.lazyEvals;
+  lazyEvalErrors += rhs.lazyEvalErrors;
   mHashCuts += rhs.mHashCuts;
   qHashCuts += rhs.qHashCuts;
   betaCuts += rhs.betaCuts;
@@ -92,6 +134,15 @@ SearchStats& SearchStats::operator+=(const SearchStats& rhs)
   publicWorkDepthSum += rhs.publicWorkDepthSum;
   threadAborts += rhs.threadAborts;
   abortedBranches += rhs.abortedBranches;
+  syncCount += rhs.syncCount;
+  syncMovesReplayed += rhs.syncMovesReplayed;
+  syncTime += rhs.syncTime;
+  aspirationFails += rhs.aspirationFails;
+  for(int i = 0; i<NUM_PROFILE_PHASES; i++)
+  {
+    phaseCalls[i] += rhs.phaseCalls[i];
+    phaseNanos[i] += rhs.phaseNanos[i];
+  }
 
   return *this;
 }
@@ -101,6 +152,10 @@ void SearchStats::overwriteAggregates(const SearchStats& rhs)
   mNodes = rhs.mNodes;
   qNodes = rhs.qNodes;
   evalCalls = rhs.evalCalls;
+  evalCacheHits = rhs.evalCacheHits;
+  evalCacheMisses = rhs.evalCacheMisses;
+  lazyEvals = rhs.lazyEvals;
+  lazyEvalErrors = rhs.lazyEvalErrors;
   mHashCuts = rhs.mHashCuts;
   qHashCuts = rhs.qHashCuts;
   betaCuts = rhs.betaCuts;
@@ -110,6 +165,14 @@ void SearchStats::overwriteAggregates(const SearchStats& rhs)
   publicWorkDepthSum = rhs.publicWorkDepthSum;
   threadAborts = rhs.threadAborts;
   abortedBranches = rhs.abortedBranches;
+  syncCount = rhs.syncCount;
+  syncMovesReplayed = rhs.syncMovesReplayed;
+  syncTime = rhs.syncTime;
+  for(int i = 0; i<NUM_PROFILE_PHASES; i++)
+  {
+    phaseCalls[i] = rhs.phaseCalls[i];
+    phaseNanos[i] = rhs.phaseNanos[i];
+  }
 }
 
 
@@ -17,6 +17,10 @@ struct SearchStats
   int64_t mNodes;        //Main number of nodes searched (including leaves of main search)
   int64_t qNodes;        //Quiescence nodes added
   int64_t evalCalls;     //Number of calls to eval
+  int64_t evalCacheHits;   //Evals answered by the eval cache
+  int64_t evalCacheMisses; //Evals that missed the eval cache and were computed
+  int64_t lazyEvals;       //Evals that exited early with only a bound (see SearchParams::lazyEvalPercent)
+  int64_t lazyEvalErrors;  //Lazy evals whose full eval was actually within the window, if SearchParams::lazyEvalCheck
   int64_t mHashCuts;     //Hash cutoffs made in internal search (not including leaves of main search)
   int64_t qHashCuts;     //Hash cutoffs made in quiescence (including leaves of main search)
   int64_t betaCuts;      //Beta cutoffs anywhere
@@ -28,12 +32,31 @@ struct SearchStats
   int64_t publicWorkDepthSum;  //Sum of the cDepths of the nodes gotten as public work
   int64_t threadAborts;        //Number of times a thread got aborted with wasted work
   int64_t abortedBranches;     //Estimated number of branches that were wasted work due to abort
+  int64_t syncCount;           //Number of times a thread synced with a distant splitpoint
+  int64_t syncMovesReplayed;   //Moves replayed for syncs with splitpoints that had no snapshot
+  double syncTime;             //Total time spent syncing with distant splitpoints
+
+  //Root search
+  int64_t aspirationFails; //Number of times the root was re-searched after failing outside its aspiration window
+
+  //Profiling, only recorded when compiled with SEARCH_PROFILE (see searchprofile.h)
+  //Times are inclusive, so nested phases (windef movegen within msearch movegen) overlap
+  enum ProfilePhase
+  {
+    PROFILE_MSEARCH_MOVEGEN, PROFILE_QSEARCH_MOVEGEN, PROFILE_WINDEF_MOVEGEN, PROFILE_EVAL,
+    PROFILE_HASH, PROFILE_PRUNE, PROFILE_TREES, PROFILE_SYNC, NUM_PROFILE_PHASES
+  };
+  static const char* const PROFILE_PHASE_NAMES[NUM_PROFILE_PHASES];
+  int64_t phaseCalls[NUM_PROFILE_PHASES]; //Number of times each phase ran
+  int64_t phaseNanos[NUM_PROFILE_PHASES]; //Total wall time in each phase, in nanoseconds
 
   //Statistics updated at end of search
   double timeTaken;     //Total time taken for search
+  double firstPVTime;   //Time at which the search first had a pv, 0 if it never did
   double depthReached;  //Deepest depth search finished
   eval_t finalEval;     //Final evaluation of position
   string pvString;      //Principal variation in text format
+  vector<string> multiPVStrings; //If searching multiple pvs, the eval and pv of each of the best root moves, best first
   uint64_t randSeed;    //Seed for search randomization
 
   SearchStats();
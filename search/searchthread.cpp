@@ -3,14 +3,17 @@
  * Author: davidwu
  */
 
+#include <limits>
 #include "../core/global.h"
 #include "../core/boostthread.h"
+#include "../core/numa.h"
 #include "../learning/featuremove.h"
 #include "../eval/eval.h"
 #include "../search/search.h"
 #include "../search/searchparams.h"
 #include "../search/searchthread.h"
 #include "../search/searchutils.h"
+#include "../search/searchprofile.h"
 #include "../program/arimaaio.h"
 
 using namespace std;
@@ -75,25 +78,42 @@ bool SplitPointBuffer::freeSplitPoint(SplitPoint* spt)
   isUsed[idx] = false;
   numUsed--;
   spt->isInitialized = false;
+  if(spt->snapshot != NULL)
+  {
+    spt->searcher->searchTree->freeSnapshot(spt->snapshot);
+    spt->snapshot = NULL;
+    spt->hasSnapshot = false;
+  }
   return numUsed == 0;
 }
 
 //--------------------------------------------------------------------------------------------------
 
-SearchTree::SearchTree(Searcher* s, int numThr, int maxMSearchCDepth, int maxCDepth,
-    const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData)
+SearchTree::SearchTree(Searcher* s, int numThr, int maxMSearchCDepth, int maxCDepth, bool pin)
 {
-  if(numThr <= 0 || numThr > SearchParams::MAX_THREADS)
+  if(numThr <= 0)
     Global::fatalError(string("Invalid number of threads: ") + Global::intToString(numThr));
 
   searcher = s;
   numThreads = numThr;
+  pinThreads = pin;
+  maxMSearchCDepthCapacity = maxMSearchCDepth;
+  maxCDepthCapacity = maxCDepth;
   searchDone = false;
   iterationGoing = false;
 
+  //Helper threads initialize themselves once started, below. The master's buffers are allocated while it is
+  //pinned the way it will be during search, but the caller's thread is given back its own affinity afterwards.
   threads = new SearchThread[numThreads];
-  for(int i = 0; i<numThreads; i++)
-    threads[i].initRoot(i,searcher,b,hist,uData,maxCDepth);
+  if(pinThreads)
+  {
+    vector<int> callerAffinity = Numa::getCurrentAffinity();
+    Numa::pinCurrentThread(0);
+    threads[0].initBuffers(0,searcher,maxCDepth);
+    Numa::setCurrentAffinity(callerAffinity);
+  }
+  else
+    threads[0].initBuffers(0,searcher,maxCDepth);
 
   //Overestimated worst case - each thread has an empty buffer, plus each other buffer in use is abandoned and
   //contains exactly one splitpoint
@@ -107,11 +127,21 @@ SearchTree::SearchTree(Searcher* s, int numThr, int maxMSearchCDepth, int maxCDe
   rootSptBuf = new SplitPointBuffer(s,0);
 
   rootNode = NULL;
+  numSnapshots = 0;
 
-  //Circularly doubly linked list
-  publicizedListHead = new SplitPoint();
-  publicizedListHead->publicNext = publicizedListHead;
-  publicizedListHead->publicPrev = publicizedListHead;
+  //Circularly doubly linked lists, one per thread
+  numPublicShards = numThreads;
+  publicShards = new PublicShard[numPublicShards];
+  for(int i = 0; i<numPublicShards; i++)
+  {
+    SplitPoint* head = new SplitPoint();
+    head->publicNext = head;
+    head->publicPrev = head;
+    head->publicPriority = std::numeric_limits<int>::max();
+    publicShards[i].head = head;
+  }
+  publicWorkEpoch = 0;
+  numWaitingForWork = 0;
 
   iterationNumWaiting = 0;
 
@@ -121,6 +151,14 @@ SearchTree::SearchTree(Searcher* s, int numThr, int maxMSearchCDepth, int maxCDe
 #ifdef MULTITHREADING_STD
   for(int i = 1; i<numThreads; i++)
     boostThreads[i] = std::thread(&runChild,this,searcher,&threads[i]);
+
+  //Wait for all of them to finish initializing and arrive in the holding area, so that they never
+  //initialize concurrently with beginSearch
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    while(iterationNumWaiting != numThreads-1)
+      iterationMasterCondvar.wait(lock);
+  }
 #else
   if(numThreads > 1)
     Global::fatalError("Not compiled with multithreading support!");
@@ -133,8 +171,13 @@ SearchTree::~SearchTree()
   DEBUGASSERT(!iterationGoing);
   DEBUGASSERT(iterationNumWaiting == numThreads-1);
   DEBUGASSERT(initialNumFreeSptBufs == numFreeSptBufs);
-  DEBUGASSERT(publicizedListHead->publicNext == publicizedListHead);
-  DEBUGASSERT(publicizedListHead->publicPrev == publicizedListHead);
+  ONLYINDEBUG(
+    for(int i = 0; i<numPublicShards; i++)
+    {
+      DEBUGASSERT(publicShards[i].head->publicNext == publicShards[i].head);
+      DEBUGASSERT(publicShards[i].head->publicPrev == publicShards[i].head);
+    }
+  );
   DEBUGASSERT(rootNode == NULL);
 
   //Mark search done and open the way for threads to exit
@@ -149,7 +192,9 @@ SearchTree::~SearchTree()
   DEBUGASSERT(iterationNumWaiting == 0);
 
   //Clean up memory
-  delete publicizedListHead;
+  for(int i = 0; i<numPublicShards; i++)
+    delete publicShards[i].head;
+  delete[] publicShards;
   delete[] threads;
   delete[] boostThreads;
 
@@ -158,6 +203,42 @@ SearchTree::~SearchTree()
   delete[] freeSptBufs;
 
   delete rootSptBuf;
+
+  DEBUGASSERT((int)freeSnapshots.size() == numSnapshots);
+  for(int i = 0; i<(int)freeSnapshots.size(); i++)
+    delete freeSnapshots[i];
+}
+
+bool SearchTree::canReuse(int numThr, int maxMSearchCDepth, int maxCDepth, bool pin) const
+{
+  return numThr == numThreads && pin == pinThreads &&
+      maxMSearchCDepth <= maxMSearchCDepthCapacity && maxCDepth <= maxCDepthCapacity;
+}
+
+void SearchTree::beginSearch(const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData)
+{
+  //The master thread may be a different thread than the one that created the tree, and is one the caller owns,
+  //so it is only pinned until endSearch
+  if(pinThreads)
+  {
+    masterAffinity = Numa::getCurrentAffinity();
+    Numa::pinCurrentThread(0);
+  }
+
+  //Helpers are all parked in the holding bay, and only the master thread begins iterations,
+  //so nothing else is touching the threads right now
+  std::lock_guard<std::mutex> lock(mutex);
+  DEBUGASSERT(!iterationGoing);
+  DEBUGASSERT(iterationNumWaiting == numThreads-1);
+  DEBUGASSERT(rootNode == NULL);
+  for(int i = 0; i<numThreads; i++)
+    threads[i].initRoot(b,hist,uData);
+}
+
+void SearchTree::endSearch()
+{
+  if(pinThreads)
+    Numa::setCurrentAffinity(masterAffinity);
 }
 
 SplitPoint* SearchTree::acquireRootNode()
@@ -236,60 +317,102 @@ void SearchTree::freeSplitPointBuffer(SplitPointBuffer* buf)
   DEBUGASSERT(numFreeSptBufs <= initialNumFreeSptBufs);
 }
 
+SyncSnapshot* SearchTree::acquireSnapshot()
+{
+  std::lock_guard<std::mutex> lock(snapshotMutex);
+  if(freeSnapshots.size() > 0)
+  {
+    SyncSnapshot* snapshot = freeSnapshots.back();
+    freeSnapshots.pop_back();
+    return snapshot;
+  }
+  numSnapshots++;
+  return new SyncSnapshot();
+}
+
+void SearchTree::freeSnapshot(SyncSnapshot* snapshot)
+{
+  std::lock_guard<std::mutex> lock(snapshotMutex);
+  freeSnapshots.push_back(snapshot);
+}
+
 //Publicize the SplitPoint so that other threads can help
 //The SplitPoint must be initialized with board data before this is called!
-void SearchTree::publicize(SplitPoint* spt)
+void SearchTree::publicize(SearchThread* curThread, SplitPoint* spt)
 {
-  std::lock_guard<std::mutex> lock(mutex);
-
-  DEBUGASSERT(spt->isInitialized);
-  DEBUGASSERT(!spt->isPublic);
-  DEBUGASSERT(spt->publicNext == NULL);
-  DEBUGASSERT(spt->publicPrev == NULL);
-  spt->isPublic = true;
+  //We're synced with it, so record a snapshot for other threads to sync from
+  if(!spt->hasSnapshot)
+  {
+    if(spt->snapshot == NULL)
+      spt->snapshot = acquireSnapshot();
+    spt->takeSnapshot(curThread);
+  }
 
-  //Insert into doubly linked public list
-  spt->publicNext = publicizedListHead->publicNext;
-  spt->publicPrev = publicizedListHead;
-  publicizedListHead->publicNext->publicPrev = spt;
-  publicizedListHead->publicNext = spt;
+  PublicShard& shard = publicShards[curThread->id % numPublicShards];
+  {
+    std::lock_guard<std::mutex> shardLock(shard.mutex);
+
+    DEBUGASSERT(spt->isInitialized);
+    DEBUGASSERT(!spt->isPublic);
+    DEBUGASSERT(spt->publicNext == NULL);
+    DEBUGASSERT(spt->publicPrev == NULL);
+    spt->isPublic = true;
+    spt->publicShard = curThread->id % numPublicShards;
+    spt->publicPriority = spt->rDepth4;
+
+    //Insert into doubly linked public list, after all splitpoints with at least as much remaining depth.
+    //The head has maximal priority, so this always stops by the time it wraps around.
+    SplitPoint* prev = shard.head->publicPrev;
+    while(prev->publicPriority < spt->publicPriority)
+      prev = prev->publicPrev;
+    spt->publicNext = prev->publicNext;
+    spt->publicPrev = prev;
+    prev->publicNext->publicPrev = spt;
+    prev->publicNext = spt;
+  }
 
-  publicWorkCondvar.notify_all();
+  std::lock_guard<std::mutex> lock(mutex);
+  publicWorkEpoch++;
+  if(numWaitingForWork > 0)
+    publicWorkCondvar.notify_all();
 }
 
 //Depublicize the SplitPoint. Call before this splitpoint back to buffer.
 //Okay to call for splitpoints that aren't public
 void SearchTree::depublicize(SplitPoint* spt)
 {
-  std::lock_guard<std::mutex> lock(mutex);
-  if(spt->isPublic)
-  {
-    DEBUGASSERT(spt->publicNext != NULL);
-    DEBUGASSERT(spt->publicPrev != NULL);
-
-    //Remove from doubly linked list
-    spt->publicNext->publicPrev = spt->publicPrev;
-    spt->publicPrev->publicNext = spt->publicNext;
-    spt->publicNext = NULL;
-    spt->publicPrev = NULL;
-    spt->isPublic = false;
-  }
+  if(!spt->isPublic)
+    return;
+
+  PublicShard& shard = publicShards[spt->publicShard];
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
+  DEBUGASSERT(spt->isPublic);
+  DEBUGASSERT(spt->publicNext != NULL);
+  DEBUGASSERT(spt->publicPrev != NULL);
+
+  //Remove from doubly linked list
+  spt->publicNext->publicPrev = spt->publicPrev;
+  spt->publicPrev->publicNext = spt->publicNext;
+  spt->publicNext = NULL;
+  spt->publicPrev = NULL;
+  spt->isPublic = false;
 }
 
-//Iterates through the public list trying to grab some work for the
-//current thread. Private, assumes SearchTree is locked.
+//Iterates through the public list of a shard trying to grab some work for the
+//current thread. Private, locks the shard itself.
 //Returns NULL if no public work found.
-SplitPoint* SearchTree::actuallyLookForWork(SearchThread* curThread)
+SplitPoint* SearchTree::lookForWorkInShard(SearchThread* curThread, PublicShard& shard)
 {
+  std::lock_guard<std::mutex> shardLock(shard.mutex);
   SplitPoint* bestSpt = NULL;
-  for(SplitPoint* spt = publicizedListHead->publicNext; spt != publicizedListHead; spt = spt->publicNext)
+  for(SplitPoint* spt = shard.head->publicNext; spt != shard.head; spt = spt->publicNext)
   {
     spt->lock(curThread);
 
     if(spt->probablyHasWork())
     {
       //Probably has work, sync and check again.
-      //Can sync with it while unlocked because the whole tree is locked, so the spt couldn't be returned
+      //Can sync with it while unlocked because the shard is locked, so the spt couldn't be returned
       //while we're manipulating it
       spt->unlock(curThread);
       curThread->syncWithSplitPointDistant(spt);
@@ -312,6 +435,26 @@ SplitPoint* SearchTree::actuallyLookForWork(SearchThread* curThread)
   return bestSpt;
 }
 
+//Tries each shard of the public list in turn, starting with the current thread's own, trying to grab
+//some work for the current thread. Private, assumes SearchTree is NOT locked.
+//Returns NULL if no public work found.
+SplitPoint* SearchTree::actuallyLookForWork(SearchThread* curThread)
+{
+  int startShard = curThread->id % numPublicShards;
+  for(int i = 0; i<numPublicShards; i++)
+  {
+    int shardIdx = (startShard + i) % numPublicShards;
+    //Unsynchronized peek to skip empty shards without touching their lock. A splitpoint publicized
+    //after this check bumps publicWorkEpoch, so getPublicWork will look again instead of waiting.
+    if(publicShards[shardIdx].head->publicNext == publicShards[shardIdx].head)
+      continue;
+    SplitPoint* bestSpt = lookForWorkInShard(curThread,publicShards[shardIdx]);
+    if(bestSpt != NULL)
+      return bestSpt;
+  }
+  return NULL;
+}
+
 //Find a good publicized SplitPoint and grab work from it for the given thread.
 //If none, blocks until there is some. Returns the splitpoint UNLOCKED, with
 //the thread having successfully grabbed work from it.
@@ -330,14 +473,27 @@ SplitPoint* SearchTree::getPublicWork(SearchThread* curThread)
     //Only bother looking for work if we're not terminated, if we're terminated we can't work any more.
     if(!curThread->isTerminated)
     {
+      //Search the shards without holding the main lock, so that threads looking for work
+      //don't serialize with each other or with publication
+      uint64_t epoch = publicWorkEpoch;
+      lock.unlock();
       SplitPoint* bestSpt = actuallyLookForWork(curThread);
       //Found work!
       if(bestSpt != NULL)
         return bestSpt;
+      lock.lock();
+
+      //Something was publicized while we were looking, so look again
+      if(publicWorkEpoch != epoch)
+        continue;
     }
 
-    //Don't have to check if(!iterationGoing) because we've held the mutex the whole time and checked at the top
+    //Recheck if(!iterationGoing) because we unlocked to look for work
+    if(!iterationGoing)
+      break;
+    numWaitingForWork++;
     publicWorkCondvar.wait(lock);
+    numWaitingForWork--;
   }
 
   return NULL;
@@ -362,6 +518,12 @@ SearchStats SearchTree::getCombinedStats()
 //Holding bay for "child" threads, namely all threads in the searcher that aren't the master
 void SearchTree::runChild(SearchTree* tree, Searcher* searcher, SearchThread* curThread)
 {
+  //Pin first, so that everything the thread allocates lands on its own node
+  int id = curThread - tree->threads;
+  if(tree->pinThreads)
+    Numa::pinCurrentThread(id);
+  curThread->initBuffers(id,searcher,tree->maxCDepthCapacity);
+
   std::unique_lock<std::mutex> lock(tree->mutex);
   while(true)
   {
@@ -413,6 +575,8 @@ SplitPoint::SplitPoint()
   publicNext = NULL;
   publicPrev = NULL;
   isPublic = false;
+  publicShard = 0;
+  publicPriority = 0;
 
   parent = NULL;
   isAborted = false;
@@ -476,6 +640,9 @@ SplitPoint::SplitPoint()
 
   copyKillersFromThread = -1;
 
+  hasSnapshot = false;
+  snapshot = NULL;
+
   pvsThreshold = 0x3FFFFFFF;
   r1Threshold = 0x3FFFFFFF;
   r2Threshold = 0x3FFFFFFF;
@@ -612,6 +779,7 @@ void SplitPoint::init(SplitPoint* prnt, int pMoveIdx, move_t pMove, int sMode,
   banReductionsLeq = 0;
 
   copyKillersFromThread = copyKillersFrom;
+  hasSnapshot = false;
 
   pvsThreshold = 0x3FFFFFFF;
   r1Threshold = 0x3FFFFFFF;
@@ -625,6 +793,30 @@ void SplitPoint::init(SplitPoint* prnt, int pMoveIdx, move_t pMove, int sMode,
   isInitialized = true;
 }
 
+void SplitPoint::takeSnapshot(const SearchThread* syncedThread)
+{
+  DEBUGASSERT(!isPublic);
+  DEBUGASSERT(snapshot != NULL);
+  DEBUGASSERT(syncedThread->board.sitCurrentHash == hash);
+  snapshot->board = syncedThread->board;
+  snapshot->undoData = syncedThread->undoData;
+  snapshot->history.copyTurnsFrom(syncedThread->boardHistory,searcher->mainBoard.turnNumber);
+
+  snapshot->unsafePruneIdHash.clear();
+  snapshot->unsafePruneIds.clear();
+  if(SearchParams::ALLOW_UNSTABLE && searcher->params.unsafePruneEnable)
+  {
+    int turnDepth = snapshot->board.turnNumber - searcher->mainBoard.turnNumber;
+    int len = min((int)syncedThread->unsafePruneIds.size(), turnDepth+1);
+    for(int i = 0; i<len; i++)
+    {
+      snapshot->unsafePruneIdHash.push_back(syncedThread->unsafePruneIdHash[i]);
+      snapshot->unsafePruneIds.push_back(*(syncedThread->unsafePruneIds[i]));
+    }
+  }
+  hasSnapshot = true;
+}
+
 void SplitPoint::initNodeType(bool isRoot)
 {
   nodeAllness = 0; //TODO unused
@@ -713,7 +905,7 @@ bool SplitPoint::getWork(SearchThread* curThread)
     {
       //Generate more moves
       DEBUGASSERT(curThread->board.sitCurrentHash == hash);
-      curThread->searcher->genMSearchMoves(curThread,this);
+      SEARCH_PROFILED(curThread->stats,PROFILE_MSEARCH_MOVEGEN,curThread->searcher->genMSearchMoves(curThread,this));
       DEBUGASSERT(numMoves <= mvCapacity);
     }
 
@@ -899,6 +1091,16 @@ void SplitPoint::reportResult(eval_t eval, int moveIdx, move_t move, bool result
     }
   }
 
+  //In multi-pv search, the root's alpha only rises to the worst of the best several exact evals, so that all of
+  //those moves get searched with an open window too, by whichever threads pick them up
+  bool isMultiPVRoot = nodeType == TYPE_ROOT && searcher->params.multiPV > 1;
+  if(isMultiPVRoot && eval > alphaValue)
+  {
+    eval_t newAlpha = searcher->recordRootPV(moveIdx,move,eval,alphaValue,
+        curThread->getPV(fDepth+1),curThread->getPVLen(fDepth+1));
+    alpha.store(newAlpha,std::memory_order_relaxed);
+  }
+
   //Update best and alpha
   if(eval > bestEval)
   {
@@ -908,7 +1110,8 @@ void SplitPoint::reportResult(eval_t eval, int moveIdx, move_t move, bool result
 
     if(eval > alphaValue)
     {
-      alpha.store(eval,std::memory_order_relaxed);
+      if(!isMultiPVRoot)
+        alpha.store(eval,std::memory_order_relaxed);
       bestFlag = Flags::FLAG_EXACT;
     }
 
@@ -941,11 +1144,6 @@ SearchThread::SearchThread()
   id = -1;
   searcher = NULL;
 
-  pv = new move_t*[SearchParams::PV_ARRAY_SIZE];
-  for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
-    pv[i] = new move_t[SearchParams::PV_ARRAY_SIZE];
-  pvLen = new int[SearchParams::PV_ARRAY_SIZE];
-
   curSplitPointMoveIdx = -1;
   curSplitPointMove = ERRMOVE;
   curPruneReduceDesired = false;
@@ -958,9 +1156,12 @@ SearchThread::SearchThread()
   killerMoves = NULL;
   killerMovesLen = 0;
 
-  mvListCapacity = SearchParams::QMAX_FDEPTH * SearchParams::QSEARCH_MOVE_CAPACITY;
-  mvList = new move_t[mvListCapacity];
-  hmList = new int[mvListCapacity];
+  //Buffers are allocated in initBuffers
+  pv = NULL;
+  pvLen = NULL;
+  mvList = NULL;
+  hmList = NULL;
+  mvListCapacity = 0;
   mvListCapacityUsed = 0;
 }
 
@@ -976,29 +1177,55 @@ SearchThread::~SearchThread()
   for(size_t i = 0; i < unsafePruneIds.size(); i++)
     delete unsafePruneIds[i];
 
-  for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
-    delete[] pv[i];
-  delete[] pv;
+  if(pv != NULL)
+  {
+    for(int i = 0; i<SearchParams::PV_ARRAY_SIZE; i++)
+      delete[] pv[i];
+    delete[] pv;
+  }
   delete[] pvLen;
 }
 
-//Initialize this search thread to be ready to search for the given root position
-void SearchThread::initRoot(int i, Searcher* s, const Board& b, const BoardHistory& hist,
-    const vector<UndoMoveData>& uData, int maxCDepth)
+//Allocate the buffers for this search thread
+void SearchThread::initBuffers(int i, Searcher* s, int maxCDepth)
 {
   id = i;
   searcher = s;
+
+  DEBUGASSERT(pv == NULL && mvList == NULL && killerMoves == NULL);
+  pv = new move_t*[SearchParams::PV_ARRAY_SIZE];
+  for(int j = 0; j<SearchParams::PV_ARRAY_SIZE; j++)
+    pv[j] = new move_t[SearchParams::PV_ARRAY_SIZE];
+  pvLen = new int[SearchParams::PV_ARRAY_SIZE];
+
+  mvListCapacity = SearchParams::QMAX_FDEPTH * SearchParams::QSEARCH_MOVE_CAPACITY;
+  mvList = new move_t[mvListCapacity];
+  hmList = new int[mvListCapacity];
+  mvListCapacityUsed = 0;
+
+  int killerLen = maxCDepth+1;
+  killerMoves = new KillerEntry[killerLen];
+  for(int j = 0; j<killerLen; j++)
+    killerMoves[j] = KillerEntry();
+  killerMovesLen = killerLen;
+}
+
+//Initialize this search thread to be ready to search for the given root position
+void SearchThread::initRoot(const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData)
+{
+  DEBUGASSERT(lockedSpt == NULL);
+  DEBUGASSERT(curSplitPointBuffer == NULL);
   board = b;
   boardHistory = hist;
   undoData = uData;
+  stats = SearchStats();
   isTerminated = false;
   timeCheckCounter = 0;
+  mvListCapacityUsed = 0;
 
-  int killerLen = maxCDepth+1;
-  killerMoves = new KillerEntry[killerLen];
-  for(int j = 0; j<killerLen; j++)
+  //Killers from a previous search are for a different position
+  for(int j = 0; j<killerMovesLen; j++)
     killerMoves[j] = KillerEntry();
-  killerMovesLen = killerLen;
 }
 
 //Copy killer moves from the appropriate thread for this splitpoint, when we are joining in
@@ -1053,6 +1280,40 @@ void SearchThread::copyKillersForSplitPointDistant(const SplitPoint* spt)
 //the search tree is locked the whole time, so that this splitpoint won't unexpectedly get
 //depublicized and returned at the same time as this function runs!
 void SearchThread::syncWithSplitPointDistant(const SplitPoint* spt)
+{
+  //Distant syncs copy or replay a whole board and history, so timing them always is cheap by comparison
+  ClockTimer timer;
+  if(spt->hasSnapshot)
+    SEARCH_PROFILED(stats,PROFILE_SYNC,syncFromSnapshot(spt));
+  else
+    SEARCH_PROFILED(stats,PROFILE_SYNC,syncByReplay(spt));
+  stats.syncCount++;
+  stats.syncTime += timer.getSeconds();
+}
+
+void SearchThread::syncFromSnapshot(const SplitPoint* spt)
+{
+  //Turns prior to the root are never touched during search, so only the rest of the history needs copying
+  const SyncSnapshot* snapshot = spt->snapshot;
+  board = snapshot->board;
+  undoData = snapshot->undoData;
+  boardHistory.copyTurnsFrom(snapshot->history,searcher->mainBoard.turnNumber);
+
+  int len = snapshot->unsafePruneIds.size();
+  while((int)unsafePruneIds.size() < len)
+  {
+    unsafePruneIdHash.push_back(0);
+    unsafePruneIds.push_back(new vector<SearchPrune::ID>());
+  }
+  for(int i = 0; i<len; i++)
+  {
+    unsafePruneIdHash[i] = snapshot->unsafePruneIdHash[i];
+    *(unsafePruneIds[i]) = snapshot->unsafePruneIds[i];
+  }
+  DEBUGASSERT(board.sitCurrentHash == spt->hash);
+}
+
+void SearchThread::syncByReplay(const SplitPoint* spt)
 {
   //Make moves forward from the start until we're at the splitpoint.
   board = searcher->mainBoard;
@@ -1092,6 +1353,7 @@ void SearchThread::syncWithSplitPointDistant(const SplitPoint* spt)
       searcher->maybeComputePosData(board,boardHistory,rDepth4UpperBound,this);
   }
   DEBUGASSERT(cDepth == finalCDepth);
+  stats.syncMovesReplayed += numSearchTurns;
 }
 
 
@@ -1221,7 +1483,7 @@ void Searcher::mainLoop(SearchThread* curThread, SplitPoint* spt)
       bool needsPublication = spt->needsPublication();
       spt->unlock(curThread);
       if(needsPublication)
-        searchTree->publicize(spt);
+        searchTree->publicize(curThread,spt);
     }
 
     //At this point, we have an unlocked splitpoint that we've grabbed work from.
@@ -1385,3 +1647,106 @@ void SimpleLock::unlock()
 
 
 
+
+//LAZY SMP---------------------------------------------------------------------------
+
+LazySMPPool::LazySMPPool(Searcher* m, int numHelpers)
+:master(m),helpers(),threads(),shutdown(false),searchCount(0),numRunning(0),nextSearchId(0),
+ pinThreads(false),board(),hist(),maxDepth(0)
+{
+  //Helpers are created with tiny tables of their own, which are replaced by the master's upon starting
+  SearchParams p = master->params;
+  p.numThreads = 1;
+  p.lazySMP = false;
+  p.mainHashExp = 10;
+  p.evalCacheExp = 0;
+  for(int i = 0; i<numHelpers; i++)
+    helpers.push_back(new Searcher(p));
+  for(int i = 0; i<numHelpers; i++)
+    threads.push_back(std::thread(&runHelper,this,i));
+}
+
+LazySMPPool::~LazySMPPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    DEBUGASSERT(numRunning == 0);
+    shutdown = true;
+    startCondvar.notify_all();
+  }
+  for(int i = 0; i<(int)threads.size(); i++)
+    threads[i].join();
+  for(int i = 0; i<(int)helpers.size(); i++)
+    delete helpers[i];
+}
+
+int LazySMPPool::getNumHelpers() const
+{
+  return (int)helpers.size();
+}
+
+void LazySMPPool::runHelper(LazySMPPool* pool, int idx)
+{
+  Searcher* helper = pool->helpers[idx];
+  uint64_t searchesDone = 0;
+  std::unique_lock<std::mutex> lock(pool->mutex);
+  while(true)
+  {
+    while(!pool->shutdown && pool->searchCount == searchesDone)
+      pool->startCondvar.wait(lock);
+    if(pool->shutdown)
+      break;
+    searchesDone = pool->searchCount;
+
+    Board b = pool->board;
+    BoardHistory hist = pool->hist;
+    int maxDepth = pool->maxDepth;
+    bool pin = pool->pinThreads;
+    lock.unlock();
+
+    if(pin)
+      Numa::pinCurrentThread(idx+1);
+    helper->searchID(b,hist,maxDepth,SearchParams::AUTO_TIME,false);
+
+    lock.lock();
+    pool->numRunning--;
+    if(pool->numRunning == 0)
+      pool->doneCondvar.notify_all();
+  }
+}
+
+void LazySMPPool::start(const Board& b, const BoardHistory& h, int depth)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  DEBUGASSERT(numRunning == 0);
+  nextSearchId++;
+  for(int i = 0; i<(int)helpers.size(); i++)
+  {
+    Searcher* helper = helpers[i];
+    helper->params = master->params;
+    helper->params.numThreads = 1;
+    helper->params.lazySMP = false;
+    helper->params.pinThreads = false;
+    helper->becomeLazyHelper(master,(i+1)%2);
+    helper->setSearchId(nextSearchId);
+  }
+  pinThreads = master->params.pinThreads;
+  board = b;
+  hist = h;
+  maxDepth = depth;
+  numRunning = (int)helpers.size();
+  searchCount++;
+  startCondvar.notify_all();
+}
+
+void LazySMPPool::stop(SearchStats& stats)
+{
+  for(int i = 0; i<(int)helpers.size(); i++)
+    helpers[i]->interruptExternal(nextSearchId);
+
+  std::unique_lock<std::mutex> lock(mutex);
+  while(numRunning > 0)
+    doneCondvar.wait(lock);
+  for(int i = 0; i<(int)helpers.size(); i++)
+    stats += helpers[i]->stats;
+}
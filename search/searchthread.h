@@ -18,6 +18,7 @@ using namespace std;
 struct SplitPointBuffer;
 struct SearchThread;
 struct SplitPoint;
+struct SyncSnapshot;
 class SearchTree;
 
 //Notes:
@@ -34,8 +35,11 @@ class SearchTree;
 //finished, the SplitPoint is freed. This allocation is not done dynamically, but rather from preallocated
 //SplitPointBuffers (see below).
 //
-//Whenever a thread wishes, it can publicize the SplitPoint it is working on, adding it to a global list
-//of available work for free threads. Critical SplitPoint operations are performed with a per-SplitPoint mutex.
+//Whenever a thread wishes, it can publicize the SplitPoint it is working on, adding it to the lists of available
+//work for free threads. These lists are sharded, one per thread, each with its own mutex, so that threads
+//publicizing work and free threads looking for work mostly do not contend with each other. A free thread searches
+//its own shard first and then the others in turn. Critical SplitPoint operations are performed with a
+//per-SplitPoint mutex.
 //
 //Every SplitPoint must always have at least one thread working on it or a subtree extending from it. To maintain
 //this invariant, the last thread to finish working at a SplitPoint and finish the SplitPoint must back up to the
@@ -74,6 +78,7 @@ class SearchTree;
 //Lock acquisition order:
 //Can only acquire locks in this order:
 //  SearchTree
+//  Public list shard
 //  Individual splitpoint
 //
 
@@ -118,6 +123,12 @@ class SearchTree
   //Search data
   int numThreads;         //Number of threads
   SearchThread* threads;   //Array of all threads
+  bool pinThreads;        //Were the threads pinned to cpus?
+  vector<int> masterAffinity; //Cpus the master thread could run on before beginSearch pinned it
+
+  //Capacity of the buffers allocated, any search needing no more than this can reuse this tree
+  int maxMSearchCDepthCapacity;
+  int maxCDepthCapacity;
 
   //SplitPoint buffers
   int initialNumFreeSptBufs;      //How many are there initially?
@@ -128,10 +139,30 @@ class SearchTree
   //Root node of search
   SplitPoint* rootNode;
 
+  //Pool of sync snapshots, grown on demand. One is attached to a splitpoint only from when it is first
+  //publicized until it is freed, so the pool grows with the amount of public work at once rather than with the
+  //number of preallocated splitpoints. Its mutex is never held while acquiring any other lock.
+  std::mutex snapshotMutex;
+  vector<SyncSnapshot*> freeSnapshots;
+  int numSnapshots;
+
   //Publicized splitpoints - SplitPoints that are available work for free threads.
-  //Intrusive linked list using publicNext and publicPrev pointers in splitpoint
-  //Head node is a dummy splitpoint, unused.
-  SplitPoint* publicizedListHead;
+  //Split into shards, each an intrusive linked list using publicNext and publicPrev pointers in splitpoint,
+  //kept sorted by decreasing rDepth4 at the time of publication so that the splitpoints with the most
+  //expected work are offered first. Head node is a dummy splitpoint, unused.
+  struct PublicShard
+  {
+    std::mutex mutex;
+    SplitPoint* head;
+    char padding[CACHE_LINE_BUFFER_SIZE]; //Keep different shards' locks off of the same cache line
+  };
+  int numPublicShards;
+  PublicShard* publicShards;
+
+  //Incremented under the main mutex whenever a splitpoint is publicized, so that a thread that found no work
+  //can tell whether any was added since it started looking before it waits.
+  uint64_t publicWorkEpoch;
+  int numWaitingForWork; //Number of threads waiting on publicWorkCondvar
 
   //Actual boost library thread objects
   std::thread* boostThreads;
@@ -148,11 +179,19 @@ class SearchTree
   std::condition_variable iterationMasterCondvar; //Master waits here until all threads are in holding
 
   public:
-  SearchTree(Searcher* searcher, int numThreads, int maxMSearchDepth, int maxCDepth,
-      const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData);
+  //Spawns the helper threads, which allocate their buffers and then park in the holding bay until a search
+  //starts. The tree is meant to be kept and reused across many searches.
+  SearchTree(Searcher* searcher, int numThreads, int maxMSearchCDepth, int maxCDepth, bool pinThreads);
   ~SearchTree();
 
   //SEARCH INTERFACE------------------------------------------------
+  //Can this tree be used for a search with the given requirements?
+  bool canReuse(int numThreads, int maxMSearchCDepth, int maxCDepth, bool pinThreads) const;
+  //Prepare all threads to search from the given root position. Call from master thread before any iterations.
+  void beginSearch(const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData);
+  //Call from the master thread once the search is over, to undo pinning it to a cpu for the search.
+  void endSearch();
+
   //Get the root node, for the purposes of initialization
   SplitPoint* acquireRootNode();
   //Free the root node
@@ -175,10 +214,14 @@ class SearchTree
   //Free an unused buffer of splitpoints that has been disowned, or one's own buffer
   void freeSplitPointBuffer(SplitPointBuffer* buf);
 
+  //Get a snapshot to attach to a splitpoint, or return one once the splitpoint is freed
+  SyncSnapshot* acquireSnapshot();
+  void freeSnapshot(SyncSnapshot* snapshot);
+
 
-  //Publicize the SplitPoint so that other threads can help
+  //Publicize the SplitPoint so that other threads can help, into the shard for the given thread
   //The SplitPoint must be initialized with board data before this is called!
-  void publicize(SplitPoint* spt);
+  void publicize(SearchThread* curThread, SplitPoint* spt);
   //Depublicize the SplitPoint. Call only when returning this splitpoint back to buffer.
   //Okay to call for splitpoints that aren't public
   void depublicize(SplitPoint* spt);
@@ -203,6 +246,18 @@ class SearchTree
   private:
   static void runChild(SearchTree* tree, Searcher* searcher, SearchThread* curThread);
   SplitPoint* actuallyLookForWork(SearchThread* curThread);
+  SplitPoint* lookForWorkInShard(SearchThread* curThread, PublicShard& shard);
+};
+
+//The state of a thread synced with a splitpoint, so that threads joining in can sync by copying it rather
+//than by replaying every move from the root.
+struct SyncSnapshot
+{
+  Board board;
+  vector<UndoMoveData> undoData;
+  BoardHistory history;  //Only turns from the root turn onward are meaningful
+  vector<hash_t> unsafePruneIdHash;
+  vector<vector<SearchPrune::ID> > unsafePruneIds;
 };
 
 //A single node in the seach tree at which we are parallelizing
@@ -232,12 +287,14 @@ struct SplitPoint
   SplitPointBuffer* buffer; //The SplitPointBuffer containing this splitpoint
   int bufferIdx;            //The index of this splitpoint in the buffer
 
-  //Data synchronized under SearchTree------------------------------------------------------------
+  //Data synchronized under the SearchTree public list shard this is in--------------------------
 
-  //Intrusive doubly-linked list for SearchTree::publicizedListHead
+  //Intrusive doubly-linked list for SearchTree::publicShards
   SplitPoint* publicNext;
   SplitPoint* publicPrev;
   bool isPublic;
+  int publicShard;    //Which shard this is in, if isPublic
+  int publicPriority; //Sort key within the shard, higher is offered first
 
   //Data synchronized under SplitPoint------------------------------------------------------------
   //Any of the below, including parameters that "seem" constant, MAY CHANGE in the middle of search
@@ -329,6 +386,13 @@ struct SplitPoint
 
   int copyKillersFromThread; //Copy killer moves from this thread when joining this splitpoint, if not -1.
 
+  //Snapshot of a thread synced with this splitpoint, taken when it is publicized, from the SearchTree's pool.
+  //Stays attached while the splitpoint is in use, including across re-searches, and is returned when it is freed.
+  //Written only while the splitpoint is not public, and read only by threads holding the lock of the public
+  //list shard that contains it, so it needs no further synchronization.
+  bool hasSnapshot;        //Does snapshot hold the state for the current position?
+  SyncSnapshot* snapshot;  //NULL if none attached
+
   //Different pruning amounts. Perform this when moveIdx >= threshold
   int pvsThreshold;
   int r1Threshold;
@@ -353,6 +417,10 @@ struct SplitPoint
   //Helper
   void initNodeType(bool isRoot);
 
+  //Record the snapshot above from a thread that is currently synced with this splitpoint
+  //Call only when this splitpoint is not public and has a snapshot attached.
+  void takeSnapshot(const SearchThread* syncedThread);
+
   //Synchronization--------------------------------------
   void lock(SearchThread* thread);
   void unlock(SearchThread* thread);
@@ -469,10 +537,13 @@ struct SearchThread
   SearchThread();
   ~SearchThread();
 
+  //Allocate the buffers of this search thread, once, from the thread that will use it so that
+  //the buffers end up in memory local to that thread
+  void initBuffers(int id, Searcher* searcher, int maxCDepth);
+
   //Initialize this search thread to be ready to search for the given root position
-  //Called only once, at the start of search before any iterations
-  void initRoot(int id, Searcher* searcher, const Board& b, const BoardHistory& hist,
-      const vector<UndoMoveData>& uData, int maxCDepth);
+  //Called at the start of each search before any iterations, while the thread is not running
+  void initRoot(const Board& b, const BoardHistory& hist, const vector<UndoMoveData>& uData);
 
   //Search control logic------------------------------------
 
@@ -480,10 +551,16 @@ struct SearchThread
   //continuation of any existing splitpoint. That is, called when we begin searching at the root, as well
   //as when we jump to a different splitpoint in the tree and join in.
   //IMPORTANT: No need for splitpoint to be locked, but if so, then it must be the case that
-  //the search tree is locked the whole time, so that this splitpoint won't unexpectedly get
+  //the public list shard containing it is locked the whole time, so that this splitpoint won't unexpectedly get
   //depublicized and returned at the same time as this function runs!
   void syncWithSplitPointDistant(const SplitPoint* spt);
 
+  private:
+  //Helpers for syncWithSplitPointDistant
+  void syncFromSnapshot(const SplitPoint* spt);
+  void syncByReplay(const SplitPoint* spt);
+  public:
+
   //Copy killer moves from the appropriate thread for this splitpoint, when we are joining in
   //and trying to sync with it.
   //Splitpoint need not be locked, however this thread should have work allocated from it.
@@ -509,6 +586,45 @@ struct SearchThread
   int getPVLen(int fDepth);
 };
 
+//Helper searches for the lazy SMP parallel mode. Each helper is a whole single-threaded Searcher running its own
+//iterative deepening on a private board in its own thread, sharing only the hashtables with the master searcher.
+//Helpers alternate between starting at the usual depth and one deeper, so that they don't all search in lockstep.
+//The helper threads live as long as the pool, parked between searches.
+class LazySMPPool
+{
+  Searcher* master;
+  vector<Searcher*> helpers;
+  vector<std::thread> threads;
+
+  //Protects everything below
+  std::mutex mutex;
+  std::condition_variable startCondvar; //Helpers wait here for the next search
+  std::condition_variable doneCondvar;  //Master waits here for helpers to finish a search
+  bool shutdown;        //Set on destruction, helper threads exit
+  uint64_t searchCount; //Incremented for every search started, helpers start when they see it change
+  int numRunning;       //Number of helpers still searching the current search
+  int nextSearchId;     //SearchId given to the helpers for the current search, by which they're interrupted
+  bool pinThreads;      //Pin helpers for the current search?
+  Board board;          //Position for the current search
+  BoardHistory hist;
+  int maxDepth;
+
+  public:
+  LazySMPPool(Searcher* master, int numHelpers);
+  ~LazySMPPool();
+
+  int getNumHelpers() const;
+
+  //Begin all helpers searching the given position up to maxDepth with the master's current params and no time
+  //limit. Call only from the master's thread after it has begun its search and set up the hashtables.
+  void start(const Board& b, const BoardHistory& hist, int maxDepth);
+  //Interrupt all helpers and wait for them to finish, adding their aggregate stats into stats.
+  void stop(SearchStats& stats);
+
+  private:
+  static void runHelper(LazySMPPool* pool, int idx);
+};
+
 //Simple lock for search.h to use, so that we don't have to include boost thread
 //in search.h which everything else includes.
 class SimpleLock
@@ -4,8 +4,16 @@
  */
 
 #include <sstream>
+#include <fstream>
+#if defined(_MSC_VER)
+#include <xmmintrin.h>
+#endif
 #include "../core/global.h"
 #include "../core/rand.h"
+#include "../core/timer.h"
+#include "../core/boostthread.h"
+#include "../core/largealloc.h"
+#include "../core/numa.h"
 #include "../board/board.h"
 #include "../board/boardhistory.h"
 #include "../board/boardmovegen.h"
@@ -827,132 +835,6 @@ void SearchUtils::recordKiller(KillerEntry* killerMoves, int killerMovesLen, mov
 }
 
 
-//HELPERS - HISTORY---------------------------------------------------------------------
-
-//TODO make this distinguish pushpulls from consecutive nearby steps more perfectly
-static int getHistoryIndex(move_t move)
-{
-  step_t step0 = getStep(move,0);
-  step_t step1 = getStep(move,1);
-  if(step1 == ERRSTEP || step1 == PASSSTEP || step1 == QPASSSTEP)
-    return (int)step0;
-
-  if(gDest(step1) != gSrc(step0) || gDest(step0) == gSrc(step1))
-    return (int)step0;
-  return (int)step0 + (int)gDir(step1)*256+256;
-}
-
-static int getHistoryDepth(int cDepth)
-{
-  return cDepth;
-}
-
-//HISTORY TABLE---------------------------------------------------
-//Ensure that the history table has been allocated up to the given requested depth of search.
-//Not threadsafe, call only before search!
-void SearchUtils::ensureHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax, int depth)
-{
-  while((int)historyTable.size() < depth + SearchParams::QMAX_CDEPTH)
-  {
-    int64_t* arr = new int64_t[SearchParams::HISTORY_LEN];
-    for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
-      arr[j] = 0;
-    historyTable.push_back(arr);
-    historyMax.push_back(0);
-  }
-}
-
-//Call whenever we want to clear the history table
-void SearchUtils::clearHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax)
-{
-  int size = historyTable.size();
-  for(int i = 0; i<size; i++)
-  {
-    historyMax[i] = 0;
-    for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
-      historyTable[i][j] = 0;
-  }
-}
-
-//Cut all history scores down, call between iterations of iterative deepening
-void SearchUtils::decayHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax)
-{
-  int size = historyTable.size();
-  for(int i = 0; i<size; i++)
-  {
-    historyMax[i] = (historyMax[i]+1)/6;
-    for(int j = 0; j<SearchParams::HISTORY_LEN; j++)
-      historyTable[i][j] = (historyTable[i][j]+1)/6;
-  }
-}
-
-//TODO is it better if msearch, qdepth 0, and qdepth -1 don't share each other's history tables?
-void SearchUtils::updateHistoryTable(vector<int64_t*>& historyTable, vector<int64_t>& historyMax,
-    const Board& b, int cDepth, move_t move)
-{
-  (void)b;
-  if(move == ERRMOVE)
-    return;
-
-  int dIndex = getHistoryDepth(cDepth);
-  if((int)historyTable.size() <= dIndex)
-    return;
-
-  int hIndex = getHistoryIndex(move);
-  int64_t val;
-  if(hIndex >= 256)
-    val = (historyTable[dIndex][hIndex] += 2);
-  else
-    val = ++(historyTable[dIndex][hIndex]);
-  if(val > historyMax[dIndex])
-    historyMax[dIndex] = val;
-}
-
-void SearchUtils::getHistoryScores(const vector<int64_t*>& historyTable, const vector<int64_t>& historyMax,
-    const Board& b, pla_t pla, int cDepth, const move_t* mv, int* hm, int len)
-{
-  (void)b;
-  (void)pla;
-  int dIndex = getHistoryDepth(cDepth);
-  DEBUGASSERT((int)historyTable.size() > dIndex)
-
-  int64_t histMax = historyMax[dIndex];
-  if(histMax == 0)
-    return;
-
-  int64_t* histTable = historyTable[dIndex];
-  for(int m = 0; m < len; m++)
-  {
-    move_t move = mv[m];
-
-    int hIndex = getHistoryIndex(move);
-    int64_t score = histTable[hIndex];
-    if(score > histMax)
-      score = histMax;
-    hm[m] += (int)(score*SearchParams::HISTORY_SCORE_MAX/histMax);
-  }
-}
-
-int SearchUtils::getHistoryScore(const vector<int64_t*>& historyTable, const vector<int64_t>& historyMax,
-    const Board& b, pla_t pla, int cDepth, move_t move)
-{
-  (void)b;
-  (void)pla;
-  int dIndex = getHistoryDepth(cDepth);
-  DEBUGASSERT((int)historyTable.size() > dIndex)
-
-  int64_t histMax = historyMax[dIndex];
-  if(histMax == 0)
-    return 0;
-
-  int hIndex = getHistoryIndex(move);
-  int64_t score = historyTable[dIndex][hIndex];
-  if(score > histMax)
-    score = histMax;
-  return (int)(score*SearchParams::HISTORY_SCORE_MAX/histMax);
-}
-
-
 
 
 /*
@@ -1025,7 +907,7 @@ SearchHashEntry::SearchHashEntry()
   key = 0;
 }
 
-void SearchHashEntry::record(hash_t hash, int16_t depth, eval_t eval, flag_t flag, move_t move)
+void SearchHashEntry::record(hash_t hash, uint8_t gen, int16_t depth, eval_t eval, flag_t flag, move_t move)
 {
   //Assert that eval uses only only 21 bits (except for sign extension)
   DEBUGASSERT((eval & 0xFFF00000) == 0 || (eval & 0xFFF00000) == 0xFFF00000);
@@ -1042,7 +924,7 @@ void SearchHashEntry::record(hash_t hash, int16_t depth, eval_t eval, flag_t fla
     uint64_t oldRKey = key;
     //Verify that hash key matches, using lockless xor scheme
     //And if so, then grab the old hashmove out and replace our move with it
-    if((oldRKey ^ oldRData) == hash)
+    if(((oldRKey ^ oldRData) & ~GEN_MASK) == (hash & ~GEN_MASK))
     {
       move_t oldMove = (move_t)(oldRData >> 32);
       if(oldMove != ERRMOVE)
@@ -1055,7 +937,7 @@ void SearchHashEntry::record(hash_t hash, int16_t depth, eval_t eval, flag_t fla
   uint64_t rData = ((uint64_t)move << 32) | subWord;
 
   data = rData;
-  key = hash ^ rData;
+  key = ((hash & ~GEN_MASK) | gen) ^ rData;
 }
 
 bool SearchHashEntry::lookup(hash_t hash, int16_t& depth, eval_t& eval, flag_t& flag, move_t& move)
@@ -1064,7 +946,7 @@ bool SearchHashEntry::lookup(hash_t hash, int16_t& depth, eval_t& eval, flag_t&
   uint64_t rKey = key;
 
   //Verify that hash key matches, using lockless xor scheme
-  if((rKey ^ rData) != hash)
+  if(((rKey ^ rData) & ~GEN_MASK) != (hash & ~GEN_MASK))
     return false;
 
   uint32_t subWord = (uint32_t)rData;
@@ -1082,6 +964,30 @@ bool SearchHashEntry::lookup(hash_t hash, int16_t& depth, eval_t& eval, flag_t&
   return true;
 }
 
+bool SearchHashEntry::matches(hash_t hash) const
+{
+  uint64_t rData = data;
+  uint64_t rKey = key;
+  return ((rKey ^ rData) & ~GEN_MASK) == (hash & ~GEN_MASK) && (flag_t)(rData & 0x3) != Flags::FLAG_NONE;
+}
+
+void SearchHashEntry::getReplaceInfo(uint8_t& gen, int16_t& depth, flag_t& flag) const
+{
+  uint64_t rData = data;
+  uint64_t rKey = key;
+  uint32_t subWord = (uint32_t)rData;
+  gen = (uint8_t)((rKey ^ rData) & GEN_MASK);
+  depth = (int16_t)(((int32_t)(subWord << 21)) >> 23);
+  flag = (flag_t)(subWord & 0x3);
+}
+
+void SearchHashEntry::shiftGenerationBack(uint8_t shift)
+{
+  uint64_t gen = (key ^ data) & GEN_MASK;
+  uint64_t newGen = gen >= shift ? gen - shift : 0;
+  key ^= gen ^ newGen;
+}
+
 int SearchHashTable::getExp(uint64_t maxMem)
 {
   uint64_t maxEntries = maxMem / sizeof(SearchHashEntry);
@@ -1091,61 +997,194 @@ int SearchHashTable::getExp(uint64_t maxMem)
   return max(shift,10);
 }
 
-SearchHashTable::SearchHashTable(int exp)
+SearchHashTable::SearchHashTable(int exp, int numThreads)
 {
+  ClockTimer timer;
   exponent = exp;
   size = ((hash_t)1) << exponent;
-  mask = size-1;
-  clearOffset = 0;
-  entries = new SearchHashEntry[size];
-  clear();
+  numBuckets = size / SearchHashBucket::NUM_ENTRIES;
+  bucketMask = numBuckets-1;
+  generation = 0;
+  contextHash = 0;
+  numNonPersistentSearches = 0;
+
+  //Page aligned, so buckets are aligned to cache lines and a probe touches only a single line.
+  //Not constructed, the clear below initializes every entry, in parallel so that large tables
+  //have their pages faulted in by many threads at once. Every thread probes the whole table, so on
+  //multi-socket machines spread it across all nodes before that first touch.
+  buckets = (SearchHashBucket*)LargeAlloc::allocate(numBuckets * sizeof(SearchHashBucket),pageType);
+  Numa::interleave(buckets,numBuckets * sizeof(SearchHashBucket));
+  clear(numThreads);
+
+  allocSeconds = timer.getSeconds();
+  allocReported = false;
 }
 
 SearchHashTable::~SearchHashTable()
 {
-  delete[] entries;
+  LargeAlloc::free(buckets,numBuckets * sizeof(SearchHashBucket),pageType);
 }
 
-void SearchHashTable::clear()
+void SearchHashTable::clearRange(hash_t start, hash_t end)
 {
-  if(clearOffset <= 0 || clearOffset >= size - 2)
+  //Flag of zero is FLAG_NONE, so no lookup can ever match a cleared entry
+  for(hash_t i = start; i<end; i++)
   {
-    //A hash of value i+1 can only get stored in an index of value i if clearOffset == size - 1
-    //so that adding it to the indended index causes it to wrap around.
-    for(hash_t i = 0; i<size; i++)
-      entries[i].record(i+1,-64,0,Flags::FLAG_NONE,ERRMOVE);
-    clearOffset = 1;
+    for(int j = 0; j<SearchHashBucket::NUM_ENTRIES; j++)
+    {
+      buckets[i].entries[j].data = 0;
+      buckets[i].entries[j].key = 0;
+    }
   }
+}
+
+void SearchHashTable::clear(int numThreads)
+{
+  //Don't bother with threads unless each one gets a decent chunk to do
+  static const hash_t MIN_BUCKETS_PER_THREAD = 1 << 16;
+  if(numThreads > 1 && numBuckets / MIN_BUCKETS_PER_THREAD < (hash_t)numThreads)
+    numThreads = (int)max((hash_t)1, numBuckets / MIN_BUCKETS_PER_THREAD);
+
+  if(numThreads <= 1)
+    clearRange(0,numBuckets);
   else
   {
-    clearOffset++;
+    vector<std::thread> threads;
+    hash_t chunk = numBuckets / numThreads;
+    for(int i = 0; i<numThreads; i++)
+    {
+      hash_t start = chunk * i;
+      hash_t end = i == numThreads-1 ? numBuckets : chunk * (i+1);
+      threads.push_back(std::thread(&SearchHashTable::clearRange,this,start,end));
+    }
+    for(int i = 0; i<numThreads; i++)
+      threads[i].join();
   }
+  generation = 0;
 }
 
-bool SearchHashTable::lookup(move_t& hashMove, eval_t& hashEval, int16_t& hashDepth, flag_t& hashFlag,
-    const Board& b, int cDepth, bool isQSearchOrEval)
+//Shift the generation of the table and every entry back by half the range, so that generation can keep
+//advancing without wrapping around and making stale entries look new. Ages of up to half the range are kept
+//exactly, and older entries are all treated as being that old.
+void SearchHashTable::shiftGenerationsBack()
+{
+  static const uint8_t SHIFT = (uint8_t)((SearchHashEntry::GEN_MASK + 1) / 2);
+  for(hash_t i = 0; i<numBuckets; i++)
+  {
+    for(int j = 0; j<SearchHashBucket::NUM_ENTRIES; j++)
+      buckets[i].entries[j].shiftGenerationBack(SHIFT);
+  }
+  generation -= SHIFT;
+}
+
+void SearchHashTable::newSearch(hash_t context, bool persist)
+{
+  //New generation, so that anything left over is preferred for replacement
+  if(generation == SearchHashEntry::GEN_MASK)
+    shiftGenerationsBack();
+  generation++;
+
+  //A context that has never been used before makes every earlier entry unreachable, and they will
+  //be replaced first since they are all from older generations.
+  if(!persist)
+  {
+    numNonPersistentSearches++;
+    context ^= numNonPersistentSearches * 0xD6E8FEB86659FD93ULL + 0x5851F42D4C957F2DULL;
+  }
+  contextHash = context;
+}
+
+hash_t SearchHashTable::getLookupHash(const Board& b, bool isQSearchOrEval) const
 {
-  //Compute appropriate slot
   //Only mix in the start position hash if we're not qsearch or eval - qsearch is fine taking a hash that ignores
   //the starting position because it allows returning to the same position and qpassing, and of course
   //eval also doesn't care about history
-  hash_t hash = b.sitCurrentHash + (SearchParams::STRICT_HASH_SAFETY && b.step != 0 && !isQSearchOrEval ?
+  return (b.sitCurrentHash ^ contextHash) + (SearchParams::STRICT_HASH_SAFETY && b.step != 0 && !isQSearchOrEval ?
       (hash_t)2862933555777941757ULL*b.posStartHash + (hash_t)3037000493ULL : (hash_t)0);
-  int hashSlot = (int)((hash+clearOffset) & mask);
+}
+
+void SearchHashTable::prefetch(const Board& b, bool isQSearchOrEval)
+{
+  hash_t hash = getLookupHash(b,isQSearchOrEval);
+  const SearchHashBucket* bucket = &buckets[hash & bucketMask];
+#if defined(__GNUC__)
+  __builtin_prefetch((const void*)bucket);
+#elif defined(_MSC_VER)
+  _mm_prefetch((const char*)bucket, _MM_HINT_T0);
+#else
+  (void)bucket;
+#endif
+}
+
+bool SearchHashTable::lookup(move_t& hashMove, eval_t& hashEval, int16_t& hashDepth, flag_t& hashFlag,
+    const Board& b, int cDepth, bool isQSearchOrEval)
+{
+  //Compute appropriate slot
+  hash_t hash = getLookupHash(b,isQSearchOrEval);
+  SearchHashBucket& bucket = buckets[hash & bucketMask];
 
   //Attempt to look up the entry
-  if(entries[hashSlot].lookup(hash,hashDepth,hashEval,hashFlag,hashMove))
+  for(int i = 0; i<SearchHashBucket::NUM_ENTRIES; i++)
   {
-    //Adjust for terminal eval
-    if(SearchUtils::isWinEval(hashEval))
-      hashEval -= cDepth;
-    else if(SearchUtils::isLoseEval(hashEval))
-      hashEval += cDepth;
-    return true;
+    if(bucket.entries[i].lookup(hash,hashDepth,hashEval,hashFlag,hashMove))
+    {
+      //Adjust for terminal eval
+      if(SearchUtils::isWinEval(hashEval))
+        hashEval -= cDepth;
+      else if(SearchUtils::isLoseEval(hashEval))
+        hashEval += cDepth;
+      return true;
+    }
   }
   return false;
 }
 
+void SearchHashTable::recordHash(hash_t hash, int16_t depth, eval_t eval, flag_t flag, move_t move)
+{
+  SearchHashBucket& bucket = buckets[hash & bucketMask];
+
+  //If the position is already in the bucket, update it in place. But don't let a qsearch or eval
+  //result clobber a main search result for the same position from this same search.
+  for(int i = 0; i<SearchHashBucket::NUM_ENTRIES; i++)
+  {
+    SearchHashEntry& entry = bucket.entries[i];
+    if(entry.matches(hash))
+    {
+      uint8_t oldGen;
+      int16_t oldDepth;
+      flag_t oldFlag;
+      entry.getReplaceInfo(oldGen,oldDepth,oldFlag);
+      if(oldGen == generation && oldDepth > 0 && depth <= 0)
+        return;
+      entry.record(hash,generation,depth,eval,flag,move);
+      return;
+    }
+  }
+
+  //Otherwise replace the least valuable entry - empty, then old, then shallow, then inexact
+  int bestIdx = 0;
+  int bestValue = 0;
+  for(int i = 0; i<SearchHashBucket::NUM_ENTRIES; i++)
+  {
+    uint8_t oldGen;
+    int16_t oldDepth;
+    flag_t oldFlag;
+    bucket.entries[i].getReplaceInfo(oldGen,oldDepth,oldFlag);
+    if(oldFlag == Flags::FLAG_NONE)
+    {bestIdx = i; break;}
+
+    int age = (uint8_t)(generation - oldGen);
+    //Doubled so that exactness only breaks ties between otherwise equal entries
+    int value = (oldDepth - age * REPLACE_AGE_WEIGHT) * 2 + (oldFlag == Flags::FLAG_EXACT ? 1 : 0);
+    if(i == 0 || value < bestValue)
+    {
+      bestIdx = i;
+      bestValue = value;
+    }
+  }
+  bucket.entries[bestIdx].record(hash,generation,depth,eval,flag,move);
+}
+
 void SearchHashTable::record(const Board& b, int cDepth,
     int16_t depth, eval_t eval, flag_t flag, move_t move, bool isQSearchOrEval)
 {
@@ -1166,16 +1205,65 @@ void SearchHashTable::record(const Board& b, int cDepth,
   bool recordWithoutStartPos = !recordWithStartPos || isQSearchOrEval;
   if(recordWithStartPos)
   {
-    hash_t hash0 = b.sitCurrentHash + (hash_t)2862933555777941757ULL*b.posStartHash + (hash_t)3037000493ULL;
-    int hashSlot0 = (int)((hash0+clearOffset) & mask);
-    entries[hashSlot0].record(hash0,depth,eval,flag,move);
+    hash_t hash0 = getLookupHash(b,false);
+    recordHash(hash0,depth,eval,flag,move);
   }
   if(recordWithoutStartPos)
   {
-    hash_t hash1 = b.sitCurrentHash;
-    int hashSlot1 = (int)((hash1+clearOffset) & mask);
-    entries[hashSlot1].record(hash1,depth,eval,flag,move);
+    hash_t hash1 = getLookupHash(b,true);
+    recordHash(hash1,depth,eval,flag,move);
+  }
+}
+
+void SearchHashTable::save(const string& file) const
+{
+  ofstream out;
+  out.open(file.c_str(), ios::out | ios::binary);
+  if(out.fail())
+    Global::fatalError("Could not open file " + file + " to save hashtable");
+
+  uint64_t header[FILE_HEADER_BYTES / sizeof(uint64_t)];
+  for(int i = 0; i<(int)(FILE_HEADER_BYTES / sizeof(uint64_t)); i++)
+    header[i] = 0;
+  header[0] = FILE_MAGIC;
+  header[1] = (uint64_t)exponent;
+  header[2] = (uint64_t)numBuckets;
+  header[3] = (uint64_t)sizeof(SearchHashBucket);
+  header[4] = (uint64_t)generation;
+  header[5] = (uint64_t)numNonPersistentSearches;
+  out.write((const char*)header, FILE_HEADER_BYTES);
+  out.write((const char*)buckets, (streamsize)(numBuckets * sizeof(SearchHashBucket)));
+  out.close();
+  if(out.fail())
+    Global::fatalError("Error writing hashtable to file " + file);
+}
+
+SearchHashTable* SearchHashTable::load(const string& file, int numThreads)
+{
+  ifstream in;
+  in.open(file.c_str(), ios::in | ios::binary);
+  if(in.fail())
+    Global::fatalError("Could not open file " + file + " to load hashtable");
+
+  uint64_t header[FILE_HEADER_BYTES / sizeof(uint64_t)];
+  in.read((char*)header, FILE_HEADER_BYTES);
+  if(in.fail() || header[0] != FILE_MAGIC)
+    Global::fatalError("File " + file + " is not a saved hashtable");
+  int exp = (int)header[1];
+  if(exp < 2 || exp > 40 || header[2] != ((hash_t)1 << exp) / SearchHashBucket::NUM_ENTRIES
+     || header[3] != (uint64_t)sizeof(SearchHashBucket))
+    Global::fatalError("Saved hashtable in " + file + " has an incompatible layout");
+
+  SearchHashTable* table = new SearchHashTable(exp,numThreads);
+  in.read((char*)table->buckets, (streamsize)(table->numBuckets * sizeof(SearchHashBucket)));
+  if(in.fail())
+  {
+    delete table;
+    Global::fatalError("Saved hashtable in " + file + " is truncated");
   }
+  table->generation = (uint8_t)header[4];
+  table->numNonPersistentSearches = header[5];
+  return table;
 }
 
 ExistsHashTable::ExistsHashTable(int exp)
@@ -1242,3 +1330,55 @@ void ExistsHashTable::record(const Board& b)
   hashKeys[hashIndex3] = hash3;
 }
 
+//EVAL CACHE-----------------------------------------------------------------------
+
+EvalCache::EvalCache(int exp)
+{
+  if(exp < 1 || exp > 40)
+    Global::fatalError("Invalid EvalCache exponent: " + Global::intToString(exp));
+  exponent = exp;
+  size = ((hash_t)1) << exponent;
+  mask = size-1;
+  entries = new Entry[size];
+  for(hash_t i = 0; i<size; i++)
+  {
+    entries[i].key = 0;
+    entries[i].data = 0;
+  }
+}
+
+EvalCache::~EvalCache()
+{
+  delete[] entries;
+}
+
+hash_t EvalCache::getHash(const Board& b, pla_t mainPla, eval_t earlyBlockadePenalty)
+{
+  hash_t hash = b.sitCurrentHash;
+  hash ^= (hash_t)(mainPla+1) * 0x9E3779B97F4A7C15ULL;
+  hash ^= (hash_t)(uint32_t)earlyBlockadePenalty * 0xC2B2AE3D27D4EB4FULL;
+  return hash;
+}
+
+bool EvalCache::lookup(hash_t hash, eval_t& eval)
+{
+  Entry& entry = entries[hash & mask];
+  uint64_t rData = entry.data;
+  uint64_t rKey = entry.key;
+
+  //Low bit of data marks the entry as filled
+  if((rData & 1) == 0 || (rKey ^ rData) != hash)
+    return false;
+
+  eval = (eval_t)(int32_t)(uint32_t)(rData >> 32);
+  return true;
+}
+
+void EvalCache::record(hash_t hash, eval_t eval)
+{
+  Entry& entry = entries[hash & mask];
+  uint64_t data = ((uint64_t)(uint32_t)eval << 32) | 1ULL;
+  entry.data = data;
+  entry.key = hash ^ data;
+}
+
@@ -103,29 +103,6 @@ namespace SearchUtils
   void getKillers(KillerEntry& buf, const KillerEntry* killerMoves, int killerMovesLen, int cDepth);
   void recordKiller(KillerEntry* killerMoves, int killerMovesLen, move_t move, int cDepth);
 
-  //HISTORY TABLE------------------------------------------------------------------------------
-  //Ensure that the history table has been allocated up to the given requested depth of search.
-  //Not threadsafe, call only before search!
-  void ensureHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax, int depth);
-
-  //Call whenever we want to clear the history table
-  void clearHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax);
-
-  //Cut all history scores down, call between iterations of iterative deepening
-  void decayHistory(vector<int64_t*>& historyTable, vector<int64_t>& historyMax);
-
-  //Update the history table
-  void updateHistoryTable(vector<int64_t*>& historyTable, vector<int64_t>& historyMax,
-      const Board& b, int cDepth, move_t move);
-
-  //Fill history scores into the hm array for all moves
-  void getHistoryScores(const vector<int64_t*>& historyTable, const vector<int64_t>& historyMax,
-      const Board& b, pla_t pla, int cDepth, const move_t* mv, int* hm, int len);
-
-  //Get the history score for a single move
-  int getHistoryScore(const vector<int64_t*>& historyTable, const vector<int64_t>& historyMax,
-      const Board& b, pla_t pla, int cDepth, move_t move);
-
   //PV--------------------------------------------------------------------------------
   void endPV(int& pvLen);
   void copyPV(const move_t* srcpv, int srcpvLen, move_t* destpv, int& destpvLen);
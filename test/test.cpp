@@ -6,6 +6,7 @@
 
 #include <cmath>
 #include <cstdlib>
+#include <algorithm>
 #include "../core/global.h"
 #include "../core/hash.h"
 #include "../core/md5.h"
@@ -13,7 +14,11 @@
 #include "../board/bitmap.h"
 #include "../board/board.h"
 #include "../board/boardmovegen.h"
+#include "../board/boardhistory.h"
 #include "../eval/strats.h"
+#include "../eval/eval.h"
+#include "../search/search.h"
+#include "../search/searchmovegen.h"
 #include "../setups/setup.h"
 #include "../test/tests.h"
 
@@ -27,6 +32,8 @@ static void testBoardStepConsistency(uint64_t seed);
 static void testBoardMoveGenConsistency(uint64_t seed);
 static void testBoardLegalityChecking(uint64_t seed);
 static void testBoardLegalityCornerCases();
+static void testFullMoveGenParallel(uint64_t seed);
+static void testEvalBatch(uint64_t seed);
 static void testRNG();
 
 void Tests::runBasicTests(uint64_t seed)
@@ -69,6 +76,14 @@ void Tests::runBasicTests(uint64_t seed)
   cout << "Specific legality corner cases" << endl;
   testBoardLegalityCornerCases();
 
+  cout << "Parallel root movegen" << endl;
+  for(int i = 0; i<20; i++)
+  {testFullMoveGenParallel(rand.nextUInt64());}
+
+  cout << "Batch eval" << endl;
+  for(int i = 0; i<5; i++)
+  {testEvalBatch(rand.nextUInt64());}
+
   cout << "----Other----" << endl;
 
   cout << "Verifying that md5 hash works" << endl;
@@ -291,6 +306,77 @@ static void testBoardMoveGenConsistency(uint64_t seed)
   delete[] hm;
 }
 
+//Generate the resulting position hashes of all full moves, and sort them
+static vector<hash_t> fullMoveGenHashes(const Board& b, const vector<move_t>& moves)
+{
+  vector<hash_t> hashes;
+  for(int i = 0; i<(int)moves.size(); i++)
+  {
+    Board copy = b;
+    bool success = copy.makeMoveLegalNoUndo(moves[i]);
+    if(!success)
+    {cout << "Illegal full move generated: " << Board::writeMove(b,moves[i]) << " " << b; exit(0);}
+    hashes.push_back(copy.sitCurrentHash);
+  }
+  std::sort(hashes.begin(),hashes.end());
+  return hashes;
+}
+
+static void testFullMoveGenParallel(uint64_t seed)
+{
+  Rand rand(seed);
+
+  Board b = Board();
+  Setup::setupRandom(b,seed);
+  Setup::setupRandom(b,seed);
+
+  //Play some random steps to get an arbitrary position
+  move_t mv[512];
+  int numRandomSteps = rand.nextUInt(60);
+  for(int i = 0; i<numRandomSteps; i++)
+  {
+    int num = BoardMoveGen::genSteps(b,b.player,mv);
+    if(b.step < 3)
+      num += BoardMoveGen::genPushPulls(b,b.player,mv+num);
+    if(num == 0 || b.isGoal(GOLD) || b.isGoal(SILV))
+      break;
+    b.makeMove(mv[rand.nextUInt(num)]);
+  }
+  if(b.isGoal(GOLD) || b.isGoal(SILV) || b.isRabbitless(GOLD) || b.isRabbitless(SILV))
+    return;
+  b.setPlaStep(b.player,0);
+  b.refreshStartHash();
+  BoardHistory hist(b);
+
+  ExistsHashTable* serialHash = new ExistsHashTable(SearchParams::DEFAULT_FULLMOVE_HASH_EXP);
+  vector<move_t> serialMoves;
+  SearchMoveGen::genFullMoves(b,hist,serialMoves,4,true,4,serialHash,NULL,NULL);
+  delete serialHash;
+
+  int numThreads = 1 + rand.nextUInt(4);
+  ExistsHashTable* hashes[5];
+  for(int i = 0; i<numThreads; i++)
+    hashes[i] = new ExistsHashTable(SearchParams::DEFAULT_FULLMOVE_HASH_EXP-2);
+  vector<move_t> parallelMoves;
+  SearchMoveGen::genFullMoves(b,hist,parallelMoves,4,true,4,hashes,numThreads,NULL,NULL);
+  for(int i = 0; i<numThreads; i++)
+    delete hashes[i];
+
+  //Neither should ever repeat a position, even with the smaller hashtables, and they should agree on the positions
+  vector<hash_t> serialHashes = fullMoveGenHashes(b,serialMoves);
+  vector<hash_t> parallelHashes = fullMoveGenHashes(b,parallelMoves);
+  if(std::adjacent_find(serialHashes.begin(),serialHashes.end()) != serialHashes.end())
+  {cout << "Serial full movegen repeated a position" << endl << b; exit(0);}
+  if(std::adjacent_find(parallelHashes.begin(),parallelHashes.end()) != parallelHashes.end())
+  {cout << "Parallel full movegen repeated a position with " << numThreads << " threads" << endl << b; exit(0);}
+  if(serialHashes != parallelHashes)
+  {
+    cout << "Parallel full movegen with " << numThreads << " threads gave " << parallelHashes.size() <<
+        " positions, serial gave " << serialHashes.size() << endl << b;
+    exit(0);
+  }
+}
+
 static void testBoardStepConsistency(uint64_t seed)
 {
   Rand rand(seed);
@@ -343,6 +429,42 @@ static void testBoardStepConsistency(uint64_t seed)
   }
 }
 
+static void testEvalBatch(uint64_t seed)
+{
+  Rand rand(seed);
+
+  Board b = Board();
+  Setup::setupRandom(b,seed);
+  Setup::setupRandom(b,seed);
+
+  //A run of positions along a random game, some from the middle of a turn
+  vector<Board> boards;
+  move_t mv[512];
+  for(int i = 0; i<200; i++)
+  {
+    int num = BoardMoveGen::genSteps(b,b.player,mv);
+    if(b.step < 3)
+      num += BoardMoveGen::genPushPulls(b,b.player,mv+num);
+    if(num == 0 || b.isGoal(GOLD) || b.isGoal(SILV) || b.isRabbitless(GOLD) || b.isRabbitless(SILV))
+      break;
+    b.makeMove(mv[rand.nextUInt(num)]);
+    boards.push_back(b);
+  }
+
+  int numBoards = boards.size();
+  int numThreads = 1 + rand.nextUInt(4);
+  vector<eval_t> evals(numBoards);
+  if(numBoards > 0)
+    Eval::evaluateBatch(boards.data(),numBoards,NPLA,0,evals.data(),numThreads);
+  for(int i = 0; i<numBoards; i++)
+  {
+    Board copy = boards[i];
+    eval_t eval = Eval::evaluate(copy,NPLA,0,NULL);
+    if(eval != evals[i])
+    {cout << "Batch eval differs: " << eval << " " << evals[i] << " threads " << numThreads << endl; cout << boards[i]; exit(0);}
+  }
+}
+
 static void testBmpBits(uint64_t seed)
 {
   Rand rand(seed);